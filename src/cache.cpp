@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cerrno>     // EINTR, errno
+#include <cstddef>    // size_t
+#include <cstdlib>    // getenv
+#include <fcntl.h>    // O_CLOEXEC, O_RDONLY, open
+#include <filesystem> // create_directories, path, rename
+#include <fstream>    // ofstream
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>   // stat
+#include <sys/types.h>  // ssize_t
+#include <system_error> // error_code
+#include <unistd.h>     // close, geteuid, getpid, read
+
+#include "cache.h"
+
+std::filesystem::path Cache::directory()
+{
+	const char* env = std::getenv("XDG_CACHE_HOME");
+	if (env != nullptr && env[0] == '/') {
+		return std::filesystem::path(env) / "manafiles";
+	}
+
+	env = std::getenv("HOME");
+	if (env != nullptr && env[0] == '/') {
+		return std::filesystem::path(env) / ".cache" / "manafiles";
+	}
+
+	return {};
+}
+
+std::filesystem::path Cache::runtimeDirectory()
+{
+	const char* env = std::getenv("XDG_RUNTIME_DIR");
+	if (env != nullptr && env[0] == '/') {
+		return std::filesystem::path(env) / "manafiles";
+	}
+
+	return {};
+}
+
+std::optional<std::string> Cache::read(const std::filesystem::path& path)
+{
+	if (path.empty() || !path.has_parent_path()) {
+		return {};
+	}
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return {};
+	}
+
+	// Cache files are small, these are read with a single call
+	std::string data;
+	char buffer[4096];
+	for (;;) {
+		ssize_t result = ::read(fd, buffer, sizeof(buffer));
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result < 0) {
+			close(fd);
+			return {};
+		}
+
+		data.append(buffer, result);
+		if (static_cast<size_t>(result) < sizeof(buffer)) {
+			break;
+		}
+	}
+
+	close(fd);
+	return data;
+}
+
+bool Cache::write(const std::filesystem::path& path, std::string_view data)
+{
+	if (path.empty() || !path.has_parent_path()) {
+		return false;
+	}
+
+	// Dont leave files behind that the owner of the directory cant replace, e.g. when running via sudo
+	auto existing = path.parent_path();
+	while (existing.has_parent_path() && existing != existing.root_path() && !std::filesystem::exists(existing)) {
+		existing = existing.parent_path();
+	}
+	struct stat status;
+	if (stat(existing.c_str(), &status) != 0 || status.st_uid != geteuid()) {
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+	if (error) {
+		return false;
+	}
+
+	// Write to a temporary file first, so readers never see a partial file
+	auto temporary = path;
+	temporary += ".tmp-" + std::to_string(getpid());
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(data.data(), data.size());
+		if (!file.good()) {
+			file.close();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <filesystem> // path
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Small files that speed up the next run, deleting them is always safe
+class Cache {
+public:
+	// $XDG_CACHE_HOME/manafiles or $HOME/.cache/manafiles, empty if unknown
+	static std::filesystem::path directory();
+	// $XDG_RUNTIME_DIR/manafiles, cleared on logout or reboot, empty if unknown
+	static std::filesystem::path runtimeDirectory();
+
+	static std::optional<std::string> read(const std::filesystem::path& path);
+	static bool write(const std::filesystem::path& path, std::string_view data);
+};
@@ -1,19 +1,25 @@
 /*
- * Copyright (C) 2022 Riyyi
+ * Copyright (C) 2022,2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>  // min_element, sort
 #include <csignal>    // raise
-#include <cstdio>     // fprintf
-#include <filesystem> // current_path, recursive_directory
+#include <cstdio>     // fprintf, printf
+#include <filesystem> // current_path, directory_iterator
 #include <fstream>    // ifstream
+#include <optional>
+#include <sstream> // istringstream
 #include <string>
+#include <system_error> // error_code
 #include <vector>
 
+#include "cache.h"
 #include "config.h"
 #include "ruc/json/json.h"
 #include "ruc/meta/assert.h"
+#include "walker.h"
 
 Config::Config(s)
 	: m_workingDirectory(std::filesystem::current_path())
@@ -29,20 +35,135 @@ Config::~Config()
 
 // -----------------------------------------
 
-void Config::findConfigFile()
+std::optional<Snapshot> Config::takeSnapshot()
 {
-	std::string configFileName = "manafiles.json";
-
-	for (const auto& path : std::filesystem::recursive_directory_iterator { m_workingDirectory }) {
-		const auto& file = path.path().string();
-		if (file.find(configFileName) + configFileName.size() == file.size()) {
-			m_config = file;
+	auto snapshot = std::move(m_snapshot);
+	m_snapshot.reset();
+
+	// Directories that were skipped have to still be ignored
+	if (snapshot.has_value()) {
+		for (const auto& directory : snapshot->prunedDirectories) {
+			if (!m_ignoreMatcher.match(directory)) {
+				return {};
+			}
 		}
 	}
 
+	return snapshot;
+}
+
+void Config::setSystemPatterns(const std::vector<std::string>& systemPatterns)
+{
+	m_settings.systemPatterns = systemPatterns;
+	m_systemMatcher = Matcher(systemPatterns);
+}
+
+void Config::setIgnorePatterns(const std::vector<std::string>& ignorePatterns)
+{
+	m_settings.ignorePatterns = ignorePatterns;
+	m_ignoreMatcher = Matcher(ignorePatterns);
+}
+
+// -----------------------------------------
+
+void Config::findConfigFile()
+{
+	const std::string configFileName = "manafiles.json";
+
+	auto found = [this](const std::filesystem::path& config) -> void {
+		m_config = config;
 #ifndef NDEBUG
-	printf("Found config file @ %s\n", m_config.c_str() + m_workingDirectorySize + 1);
+		printf("Found config file @ %s\n", m_config.c_str() + m_workingDirectorySize + 1);
 #endif
+	};
+
+	// Well-known locations
+	for (const auto& config : { m_workingDirectory / configFileName,
+	                            m_workingDirectory / ".config" / "manafiles" / configFileName }) {
+		if (std::filesystem::is_regular_file(config)) {
+			found(config);
+			return;
+		}
+	}
+
+	// Location found by a previous run, validated with a single stat
+	// Format: <working directory>\n<config file>\n
+	auto cacheFile = Cache::directory() / "config";
+	auto cache = Cache::read(cacheFile);
+	if (cache.has_value()) {
+		std::istringstream stream(cache.value());
+		std::string workingDirectory;
+		std::string config;
+		std::getline(stream, workingDirectory);
+		std::getline(stream, config);
+		if (workingDirectory == m_workingDirectory.string()
+		    && config.find(workingDirectory + '/') == 0
+		    && std::filesystem::is_regular_file(config)) {
+			found(config);
+			return;
+		}
+	}
+
+	// Breadth-first search, the config closest to the root wins
+	// The entries are kept as a snapshot, the dotfile operations continue the
+	// walk from the directories that were not listed yet
+	Snapshot snapshot;
+	bool complete = true;
+	std::vector<std::filesystem::path> directories { m_workingDirectory };
+	while (!directories.empty()) {
+		std::vector<std::filesystem::path> configs;
+		std::vector<std::filesystem::path> subdirectories;
+
+		for (const auto& directory : directories) {
+			std::error_code error;
+			auto iterator = std::filesystem::directory_iterator(directory, error);
+			for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+				const auto& entry = *it;
+
+				std::error_code statusError;
+				if (!entry.is_directory(statusError)) {
+					if (entry.path().filename() == configFileName) {
+						configs.push_back(entry.path());
+					}
+					snapshot.entries.push_back(entry);
+					continue;
+				}
+
+				// Symlinks to directories are not followed
+				if (entry.is_symlink(statusError)) {
+					continue;
+				}
+
+				// Skip ignored directories like .git/
+				auto relativePath = entry.path().string().substr(m_workingDirectorySize) + '/';
+				if (m_ignoreMatcher.match(relativePath)) {
+					snapshot.prunedDirectories.push_back(relativePath);
+					continue;
+				}
+
+				subdirectories.push_back(entry.path());
+			}
+			if (error) {
+				complete = false;
+			}
+		}
+
+		directories = std::move(subdirectories);
+
+		if (!configs.empty()) {
+			found(*std::min_element(configs.begin(), configs.end()));
+			Cache::write(cacheFile, m_workingDirectory.string() + '\n' + m_config.string() + '\n');
+			break;
+		}
+	}
+
+	if (complete) {
+		std::sort(snapshot.entries.begin(), snapshot.entries.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.path() < rhs.path();
+		});
+		snapshot.unvisitedDirectories = std::move(directories);
+		m_snapshot = std::move(snapshot);
+	}
 }
 
 void Config::parseConfigFile()
@@ -68,6 +189,20 @@ void Config::parseConfigFile()
 	}
 
 	m_settings = json.get<Settings>();
+
+	// Compile the patterns once, as they are matched against every path
+	m_ignoreMatcher = Matcher(m_settings.ignorePatterns);
+	m_systemMatcher = Matcher(m_settings.systemPatterns);
+
+	if (m_settings.deploy == "symlink") {
+		m_deploy = Deploy::Symlink;
+	}
+	else if (m_settings.deploy == "hardlink") {
+		m_deploy = Deploy::Hardlink;
+	}
+	else if (m_settings.deploy != "copy") {
+		fprintf(stderr, "\033[31;1mConfig:\033[0m unknown deploy mode '%s', copying instead\n", m_settings.deploy.c_str());
+	}
 }
 
 // -----------------------------------------
@@ -76,7 +211,9 @@ void toJson(ruc::Json& json, const Settings& settings)
 {
 	json = ruc::Json {
 		{ "ignorePatterns", settings.ignorePatterns },
-		{ "systemPatterns", settings.systemPatterns }
+		{ "systemPatterns", settings.systemPatterns },
+		{ "threads", settings.threads },
+		{ "deploy", settings.deploy }
 	};
 }
 
@@ -91,4 +228,12 @@ void fromJson(const ruc::Json& json, Settings& settings)
 	if (json.exists("systemPatterns")) {
 		json.at("systemPatterns").getTo(settings.systemPatterns);
 	}
+
+	if (json.exists("threads")) {
+		json.at("threads").getTo(settings.threads);
+	}
+
+	if (json.exists("deploy")) {
+		json.at("deploy").getTo(settings.deploy);
+	}
 }
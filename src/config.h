@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Riyyi
+ * Copyright (C) 2022,2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
@@ -7,13 +7,18 @@
 #pragma once
 
 #include <cstddef>    // size_t
+#include <cstdint>    // uint8_t, uint32_t
 #include <filesystem> // path
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "ruc/json/json.h"
 #include "ruc/singleton.h"
 
+#include "matcher.h"
+#include "walker.h"
+
 struct Settings {
 	std::vector<std::string> ignorePatterns {
 		".git/",
@@ -29,6 +34,10 @@ struct Settings {
 		"/usr/lib/",
 		"/usr/share/"
 	};
+	// Amount of threads used to walk the working directory, 0 is automatic
+	uint32_t threads { 0 };
+	// How home files are pushed: copy, symlink or hardlink
+	std::string deploy { "copy" };
 };
 
 class Config : public ruc::Singleton<Config> {
@@ -36,29 +45,50 @@ public:
 	Config(s);
 	virtual ~Config();
 
-	void setSystemPatterns(const std::vector<std::string>& systemPatterns) { m_settings.systemPatterns = systemPatterns; }
-	void setIgnorePatterns(const std::vector<std::string>& ignorePatterns) { m_settings.ignorePatterns = ignorePatterns; }
+	enum class Deploy : uint8_t {
+		Copy,
+		Symlink,
+		Hardlink,
+	};
+
+	void setSystemPatterns(const std::vector<std::string>& systemPatterns);
+	void setIgnorePatterns(const std::vector<std::string>& ignorePatterns);
+	void setThreads(uint32_t threads) { m_settings.threads = threads; }
 	void setVerbose(bool verbose) { m_verbose = verbose; }
+	void setDeploy(Deploy deploy) { m_deploy = deploy; }
 
 	const std::vector<std::string>& ignorePatterns() const { return m_settings.ignorePatterns; }
 	const std::vector<std::string>& systemPatterns() const { return m_settings.systemPatterns; }
+	const Matcher& ignoreMatcher() const { return m_ignoreMatcher; }
+	const Matcher& systemMatcher() const { return m_systemMatcher; }
+	uint32_t threads() const { return m_settings.threads; }
+	Deploy deploy() const { return m_deploy; }
 
 	const std::filesystem::path& workingDirectory() const { return m_workingDirectory; }
 	size_t workingDirectorySize() const { return m_workingDirectorySize; }
 
 	bool verbose() const { return m_verbose; }
 
+	// Hand over the working directory entries collected during config file
+	// discovery, only available once
+	std::optional<Snapshot> takeSnapshot();
+
 private:
 	void findConfigFile();
 	void parseConfigFile();
 
 	bool m_verbose { false };
+	Deploy m_deploy { Deploy::Copy };
 
 	std::filesystem::path m_workingDirectory {};
 	size_t m_workingDirectorySize { 0 };
 
 	std::filesystem::path m_config;
 	Settings m_settings;
+	std::optional<Snapshot> m_snapshot;
+
+	Matcher m_ignoreMatcher { m_settings.ignorePatterns };
+	Matcher m_systemMatcher { m_settings.systemPatterns };
 };
 
 // -----------------------------------------
@@ -0,0 +1,589 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <cerrno>  // ESRCH, errno
+#include <csignal> // kill
+#include <cstddef> // size_t
+#include <cstdio>  // renameat2
+#include <cstdlib> // free, realpath, strtol, strtoul
+#include <cstring> // strlen
+#include <fcntl.h> // AT_FDCWD, open
+#include <filesystem>
+#include <linux/fs.h> // FICLONE
+#include <string>
+#include <string_view>
+#include <sys/ioctl.h>    // ioctl
+#include <sys/sendfile.h> // sendfile
+#include <sys/stat.h>     // fchmod, fstat, lstat
+#include <sys/types.h>    // dev_t, mode_t, pid_t, ssize_t
+#include <sys/xattr.h>    // fsetxattr, lgetxattr, llistxattr
+#include <system_error>   // error_code, generic_category
+#include <unistd.h>       // close, copy_file_range, fchown, fsync, getpid, link, read, symlink, syncfs, unlink, write
+#include <utility>        // move
+#include <vector>
+
+#include "copier.h"
+
+Copier::Copier(bool deferred)
+	: m_deferred(deferred)
+	, m_umask(umask(0))
+{
+	umask(m_umask);
+}
+
+// -----------------------------------------
+
+bool Copier::copy(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& error)
+{
+	error.clear();
+	m_lastMethod = Method::None;
+
+	struct stat fromStatus;
+	if (lstat(from.c_str(), &fromStatus) != 0) {
+		error = std::error_code(errno, std::generic_category());
+		return false;
+	}
+
+	std::filesystem::path destination = to;
+	struct stat toStatus;
+	bool toExists = lstat(to.c_str(), &toStatus) == 0;
+	if (toExists && S_ISREG(fromStatus.st_mode)) {
+		followSymlink(destination, toStatus, fromStatus);
+	}
+
+	return copy(from, fromStatus, destination, toExists ? &toStatus : nullptr, error);
+}
+
+bool Copier::copy(const std::filesystem::path& from, const struct stat& fromStatus,
+                  const std::filesystem::path& to, const struct stat* toStatus, std::error_code& error)
+{
+	error.clear();
+	m_lastMethod = Method::None;
+
+	if (S_ISLNK(fromStatus.st_mode)) {
+		return copySymlink(from, to, error);
+	}
+	if (S_ISDIR(fromStatus.st_mode)) {
+		return copyDirectory(from, to, error);
+	}
+	if (S_ISREG(fromStatus.st_mode)) {
+		return copyFile(from, fromStatus, to, toStatus, error);
+	}
+
+	error = std::make_error_code(std::errc::not_supported);
+	return false;
+}
+
+bool Copier::write(const std::filesystem::path& to, std::string_view contents, mode_t mode, std::error_code& error)
+{
+	struct stat toStatus;
+	bool toExists = lstat(to.c_str(), &toStatus) == 0;
+
+	return write(to, toExists ? &toStatus : nullptr, contents, mode, error);
+}
+
+bool Copier::write(const std::filesystem::path& to, const struct stat* toStatus,
+                   std::string_view contents, mode_t mode, std::error_code& error)
+{
+	error.clear();
+	m_lastMethod = Method::None;
+
+	std::string temporary;
+	int out = openTemporary(to, toStatus, mode, temporary);
+	if (out < 0) {
+		error = std::error_code(errno, std::generic_category());
+		return false;
+	}
+
+	if (!writeAll(out, contents.data(), contents.size())) {
+		error = std::error_code(errno, std::generic_category());
+		close(out);
+		unlink(temporary.c_str());
+		return false;
+	}
+
+	if (!commit(out, temporary, to, toStatus, error)) {
+		return false;
+	}
+
+	m_lastMethod = Method::Write;
+	return true;
+}
+
+bool Copier::link(const std::filesystem::path& from, const struct stat& fromStatus,
+                  const std::filesystem::path& to, const struct stat* toStatus, bool symbolic, std::error_code& error)
+{
+	error.clear();
+	m_lastMethod = Method::None;
+
+	// Renaming a hardlink over the same file does nothing, so the temporary would remain
+	if (!symbolic && toStatus != nullptr
+	    && toStatus->st_dev == fromStatus.st_dev && toStatus->st_ino == fromStatus.st_ino) {
+		m_lastMethod = Method::Hardlink;
+		return true;
+	}
+
+	// Create the link next to the destination, then rename it over it
+	std::string temporary = temporaryPath(to);
+	int result = symbolic ? symlink(from.c_str(), temporary.c_str()) : ::link(from.c_str(), temporary.c_str());
+	if (result != 0) {
+		error = std::error_code(errno, std::generic_category());
+		return false;
+	}
+
+	if (!commit(-1, temporary, to, toStatus, error)) {
+		return false;
+	}
+
+	m_lastMethod = symbolic ? Method::Symlink : Method::Hardlink;
+	return true;
+}
+
+bool Copier::read(const std::filesystem::path& from, const struct stat& fromStatus, std::string& contents, std::error_code& error)
+{
+	error.clear();
+
+	int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+	if (in < 0) {
+		error = std::error_code(errno, std::generic_category());
+		return false;
+	}
+
+	// Ask for one byte more than the known size, so a short read marks the end of the file
+	contents.resize(static_cast<size_t>(fromStatus.st_size) + 1);
+	size_t size = 0;
+	for (;;) {
+		ssize_t result = ::read(in, contents.data() + size, contents.size() - size);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result < 0) {
+			error = std::error_code(errno, std::generic_category());
+			close(in);
+			return false;
+		}
+
+		size += result;
+		if (size < contents.size()) {
+			break;
+		}
+
+		// The file has grown since it was stat'ed
+		contents.resize(contents.size() * 2);
+	}
+	contents.resize(size);
+
+	close(in);
+	return true;
+}
+
+std::vector<Copier::Pending> Copier::takePending()
+{
+	std::vector<Pending> pending;
+	pending.swap(m_pending);
+	return pending;
+}
+
+bool Copier::rename(const Pending& pending, std::error_code& error)
+{
+	error.clear();
+
+	if (renameat2(AT_FDCWD, pending.temporary.c_str(), AT_FDCWD, pending.to.c_str(), 0) != 0) {
+		error = std::error_code(errno, std::generic_category());
+		unlink(pending.temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void Copier::discard(const Pending& pending)
+{
+	unlink(pending.temporary.c_str());
+}
+
+size_t Copier::removeStale(const std::filesystem::path& directory)
+{
+	static const pid_t self = getpid();
+
+	size_t removed = 0;
+	std::error_code error;
+	auto iterator = std::filesystem::directory_iterator(directory, error);
+	for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+		// .<name>.manafiles-<pid>-<counter>, see temporaryPath
+		auto name = it->path().filename().string();
+		size_t marker = name.rfind(".manafiles-");
+		if (name.front() != '.' || marker == std::string::npos || marker == 0) {
+			continue;
+		}
+
+		char* end = nullptr;
+		const char* number = name.c_str() + marker + strlen(".manafiles-");
+		long pid = strtol(number, &end, 10);
+		if (end == number || *end != '-' || pid <= 0 || pid == self) {
+			continue;
+		}
+		const char* counter = end + 1;
+		strtoul(counter, &end, 10);
+		if (end == counter || *end != '\0') {
+			continue;
+		}
+
+		// The process is still running, or its pid was taken over by another one
+		if (kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH) {
+			continue;
+		}
+
+		if (unlink(it->path().c_str()) == 0) {
+			removed++;
+		}
+	}
+
+	return removed;
+}
+
+bool Copier::syncFilesystem(const std::filesystem::path& directory, std::error_code& error)
+{
+	error.clear();
+
+	int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0 || syncfs(fd) != 0) {
+		error = std::error_code(errno, std::generic_category());
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	close(fd);
+	return true;
+}
+
+bool Copier::syncDirectory(const std::filesystem::path& directory, std::error_code& error)
+{
+	error.clear();
+
+	int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0 || fsync(fd) != 0) {
+		error = std::error_code(errno, std::generic_category());
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	close(fd);
+	return true;
+}
+
+bool Copier::followSymlink(std::filesystem::path& to, struct stat& toStatus, const struct stat& fromStatus)
+{
+	if (!S_ISLNK(toStatus.st_mode)) {
+		return false;
+	}
+
+	// Dangling links and links to directories or devices are replaced themselves
+	char* resolved = realpath(to.c_str(), nullptr);
+	if (resolved == nullptr) {
+		return false;
+	}
+	std::filesystem::path target = resolved;
+	free(resolved);
+
+	struct stat targetStatus;
+	if (lstat(target.c_str(), &targetStatus) != 0 || !S_ISREG(targetStatus.st_mode)) {
+		return false;
+	}
+
+	// Like a home file that was deployed as a symlink into the working directory
+	if (targetStatus.st_dev == fromStatus.st_dev && targetStatus.st_ino == fromStatus.st_ino) {
+		return false;
+	}
+
+	to = std::move(target);
+	toStatus = targetStatus;
+	return true;
+}
+
+// -----------------------------------------
+
+std::string Copier::temporaryPath(const std::filesystem::path& to)
+{
+	// Hidden file in the same directory, so the rename stays on one filesystem
+	static const pid_t pid = getpid();
+	static std::atomic<size_t> counter { 0 };
+	auto name = "." + to.filename().string() + ".manafiles-" + std::to_string(pid) + "-" + std::to_string(counter++);
+	return (to.parent_path() / name).string();
+}
+
+int Copier::openTemporary(const std::filesystem::path& to, const struct stat* toStatus, mode_t mode, std::string& temporary)
+{
+	mode &= 07777;
+
+	temporary = temporaryPath(to);
+	int out = open(temporary.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode & 0777);
+	if (out < 0) {
+		return -1;
+	}
+
+	// Keep the owner of the file that gets replaced, where allowed
+	// NOTE: Changing the owner clears the setuid and setgid bits, so do it before fchmod
+	bool owned = toStatus != nullptr && S_ISREG(toStatus->st_mode);
+	if (owned) {
+		[[maybe_unused]] int result = fchown(out, toStatus->st_uid, toStatus->st_gid);
+		copyAttributes(to, out);
+	}
+
+	// The permissions given to open are reduced by the umask and cant hold the special bits
+	if ((owned || (mode & ~0777) || (mode & m_umask)) && fchmod(out, mode) != 0) {
+		int savedErrno = errno;
+		close(out);
+		unlink(temporary.c_str());
+		errno = savedErrno;
+		return -1;
+	}
+
+	return out;
+}
+
+void Copier::copyAttributes(const std::filesystem::path& from, int out)
+{
+	// Keep the ACLs and security labels of the file that gets replaced, as
+	// far as allowed, the permissions are set afterwards like an in-place write
+	ssize_t size = llistxattr(from.c_str(), nullptr, 0);
+	if (size <= 0) {
+		return;
+	}
+
+	std::string names(size, '\0');
+	size = llistxattr(from.c_str(), names.data(), names.size());
+	if (size <= 0) {
+		return;
+	}
+
+	std::string value;
+	for (const char* name = names.data(); name < names.data() + size; name += strlen(name) + 1) {
+		ssize_t length = lgetxattr(from.c_str(), name, nullptr, 0);
+		if (length < 0) {
+			continue;
+		}
+		value.resize(length);
+		length = lgetxattr(from.c_str(), name, value.data(), value.size());
+		if (length >= 0) {
+			fsetxattr(out, name, value.data(), length, 0);
+		}
+	}
+}
+
+bool Copier::commit(int out, const std::string& temporary, const std::filesystem::path& to, const struct stat* toStatus, std::error_code& error)
+{
+	auto fail = [&error, &temporary]() -> bool {
+		error = std::error_code(errno, std::generic_category());
+		unlink(temporary.c_str());
+		return false;
+	};
+
+	// Remember the filesystem, so it can be synced once after all the copies
+	// The destination or a previous sibling already tells which one it is
+	auto directory = to.parent_path();
+	bool known = toStatus != nullptr || directory == m_lastDirectory;
+	struct stat status;
+	if (toStatus != nullptr) {
+		status = *toStatus;
+	}
+
+	if (out >= 0) {
+		bool statted = known || fstat(out, &status) == 0;
+		if (close(out) != 0 || !statted) {
+			return fail();
+		}
+	}
+	else if (!known && lstat(temporary.c_str(), &status) != 0) {
+		return fail();
+	}
+
+	if (!m_deferred && renameat2(AT_FDCWD, temporary.c_str(), AT_FDCWD, to.c_str(), 0) != 0) {
+		return fail();
+	}
+	if (m_deferred) {
+		m_pending.push_back({ temporary, to });
+	}
+
+	if (!known || toStatus != nullptr) {
+		m_filesystems.emplace(status.st_dev, directory.empty() ? "." : directory);
+	}
+	m_lastDirectory = std::move(directory);
+
+	return true;
+}
+
+bool Copier::writeAll(int fd, const char* data, size_t size)
+{
+	for (size_t written = 0; written < size;) {
+		ssize_t result = ::write(fd, data + written, size - written);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result < 0) {
+			return false;
+		}
+		written += result;
+	}
+
+	return true;
+}
+
+bool Copier::copyFile(const std::filesystem::path& from, const struct stat& status,
+                      const std::filesystem::path& to, const struct stat* toStatus, std::error_code& error)
+{
+	std::string temporary;
+
+	auto fail = [&error, &temporary](int in, int out) -> bool {
+		error = std::error_code(errno, std::generic_category());
+		if (in >= 0) {
+			close(in);
+		}
+		if (out >= 0) {
+			close(out);
+			unlink(temporary.c_str());
+		}
+		return false;
+	};
+
+	int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+	if (in < 0) {
+		return fail(in, -1);
+	}
+
+	int out = openTemporary(to, toStatus, status.st_mode, temporary);
+	if (out < 0) {
+		return fail(in, out);
+	}
+
+	// Methods that are not supported between these files fail before copying anything
+	auto unsupported = [](ssize_t copied) -> bool {
+		return copied == 0
+		       && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP || errno == EBADF);
+	};
+
+	bool done = false;
+
+	// Share the data blocks of the source, btrfs and xfs
+	// Once the filesystem has refused, dont ask again for the next files
+	if (m_reflink && ioctl(out, FICLONE, in) == 0) {
+		m_lastMethod = Method::Reflink;
+		done = true;
+	}
+	else if (m_reflink && (errno == EOPNOTSUPP || errno == EXDEV || errno == EINVAL || errno == ENOTTY)) {
+		m_reflink = false;
+	}
+
+	// In-kernel copies up to the size from the status, skipped for files that
+	// report no size like the ones in /proc
+	if (!done && status.st_size > 0) {
+		ssize_t total = 0;
+		ssize_t result = 0;
+		while (total < status.st_size && (result = copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0)) > 0) {
+			total += result;
+		}
+		if (result >= 0) {
+			m_lastMethod = Method::CopyFileRange;
+			done = true;
+		}
+		else if (!unsupported(total)) {
+			return fail(in, out);
+		}
+	}
+
+	if (!done && status.st_size > 0) {
+		ssize_t total = 0;
+		ssize_t result = 0;
+		while (total < status.st_size && (result = sendfile(out, in, nullptr, 1 << 30)) > 0) {
+			total += result;
+		}
+		if (result >= 0) {
+			m_lastMethod = Method::Sendfile;
+			done = true;
+		}
+		else if (!unsupported(total)) {
+			return fail(in, out);
+		}
+	}
+
+	if (!done) {
+		char buffer[64 * 1024];
+		for (;;) {
+			ssize_t bytesRead = ::read(in, buffer, sizeof(buffer));
+			if (bytesRead < 0 && errno == EINTR) {
+				continue;
+			}
+			if (bytesRead < 0) {
+				return fail(in, out);
+			}
+			if (bytesRead == 0) {
+				break;
+			}
+
+			if (!writeAll(out, buffer, bytesRead)) {
+				return fail(in, out);
+			}
+		}
+		m_lastMethod = Method::ReadWrite;
+	}
+
+	close(in);
+	if (!commit(out, temporary, to, toStatus, error)) {
+		m_lastMethod = Method::None;
+		return false;
+	}
+
+	return true;
+}
+
+bool Copier::copySymlink(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& error)
+{
+	auto target = std::filesystem::read_symlink(from, error);
+	if (error) {
+		return false;
+	}
+
+	// Create the symlink next to the destination, then rename it over it
+	std::string temporary = temporaryPath(to);
+	if (symlink(target.c_str(), temporary.c_str()) != 0) {
+		error = std::error_code(errno, std::generic_category());
+		return false;
+	}
+
+	if (!commit(-1, temporary, to, nullptr, error)) {
+		return false;
+	}
+
+	m_lastMethod = Method::Symlink;
+	return true;
+}
+
+bool Copier::copyDirectory(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& error)
+{
+	// Creates the directory with the permissions of the source
+	std::filesystem::create_directory(to, from, error);
+	if (error) {
+		return false;
+	}
+
+	auto iterator = std::filesystem::directory_iterator(from, error);
+	for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+		if (!copy(it->path(), to / it->path().filename(), error)) {
+			return false;
+		}
+	}
+	if (error) {
+		return false;
+	}
+
+	m_lastMethod = Method::Directory;
+	return true;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>   // stat
+#include <sys/types.h>  // dev_t, mode_t
+#include <system_error> // error_code
+#include <vector>
+
+// Copies files with the cheapest method supported by the filesystems, in order:
+// FICLONE reflink, copy_file_range, sendfile and a buffered read/write
+// Files and symlinks are written next to the destination and renamed over it,
+// so the destination is never seen half-written
+// A deferred copier leaves the renames to the caller, which first flushes the
+// data of all copies, so after a crash the destination is either the old or
+// the complete new file
+class Copier {
+public:
+	explicit Copier(bool deferred = false);
+
+	// A copy that still has to be moved over its destination
+	struct Pending {
+		std::string temporary;
+		std::filesystem::path to;
+	};
+
+	enum class Method : uint8_t {
+		None,
+		Reflink,
+		CopyFileRange,
+		Sendfile,
+		ReadWrite,
+		Write,
+		Symlink,
+		Hardlink,
+		Directory,
+	};
+
+	// Copy a file, symlink or directory, replacing the destination
+	bool copy(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& error);
+	// Same, with the status of both sides already known, toStatus is nullptr when the destination doesnt exist
+	bool copy(const std::filesystem::path& from, const struct stat& fromStatus,
+	          const std::filesystem::path& to, const struct stat* toStatus, std::error_code& error);
+
+	// Write contents to a file with the given permissions, replacing the destination
+	bool write(const std::filesystem::path& to, std::string_view contents, mode_t mode, std::error_code& error);
+	bool write(const std::filesystem::path& to, const struct stat* toStatus,
+	           std::string_view contents, mode_t mode, std::error_code& error);
+
+	// Hand over the copies made since the last call, only used when deferred
+	std::vector<Pending> takePending();
+	// Move a deferred copy over its destination
+	static bool rename(const Pending& pending, std::error_code& error);
+	// Remove a deferred copy that wont be moved over its destination
+	static void discard(const Pending& pending);
+	// Remove the copies left in a directory by runs that didnt get to rename
+	// them, like after a crash, those of running processes are kept
+	// Returns the number of copies removed
+	static size_t removeStale(const std::filesystem::path& directory);
+
+	// Link the destination to the source, with a symlink to its path or a hardlink
+	bool link(const std::filesystem::path& from, const struct stat& fromStatus,
+	          const std::filesystem::path& to, const struct stat* toStatus, bool symbolic, std::error_code& error);
+
+	// Read a whole file of which the status is known
+	bool read(const std::filesystem::path& from, const struct stat& fromStatus, std::string& contents, std::error_code& error);
+
+	Method lastMethod() const { return m_lastMethod; }
+
+	// A directory on every filesystem that was written to, by device
+	const std::map<dev_t, std::filesystem::path>& filesystems() const { return m_filesystems; }
+
+	// Flush the filesystem containing the directory to disk
+	static bool syncFilesystem(const std::filesystem::path& directory, std::error_code& error);
+	// Flush the entries of a directory to disk, like the renames done in it
+	static bool syncDirectory(const std::filesystem::path& directory, std::error_code& error);
+
+	// Write through a destination that is a symlink to a regular file, like an
+	// in-place write would, unless it points at the source itself
+	// Returns true when the destination and its status were replaced by the target
+	static bool followSymlink(std::filesystem::path& to, struct stat& toStatus, const struct stat& fromStatus);
+
+private:
+	static std::string temporaryPath(const std::filesystem::path& to);
+	int openTemporary(const std::filesystem::path& to, const struct stat* toStatus, mode_t mode, std::string& temporary);
+	static void copyAttributes(const std::filesystem::path& from, int out);
+	bool commit(int out, const std::string& temporary, const std::filesystem::path& to, const struct stat* toStatus, std::error_code& error);
+	bool writeAll(int fd, const char* data, size_t size);
+	bool copyFile(const std::filesystem::path& from, const struct stat& fromStatus,
+	              const std::filesystem::path& to, const struct stat* toStatus, std::error_code& error);
+	bool copySymlink(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& error);
+	bool copyDirectory(const std::filesystem::path& from, const std::filesystem::path& to, std::error_code& error);
+
+	Method m_lastMethod { Method::None };
+	bool m_deferred { false };
+	std::vector<Pending> m_pending;
+	mode_t m_umask { 0 };
+	bool m_reflink { true };
+	std::map<dev_t, std::filesystem::path> m_filesystems;
+	// Directory of the last replaced file, siblings are on the same filesystem
+	std::filesystem::path m_lastDirectory;
+};
@@ -1,26 +1,47 @@
 /*
- * Copyright (C) 2021-2022,2025 Riyyi
+ * Copyright (C) 2021-2022,2025-2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm> // inplace_merge, min, sort
+#include <atomic>
 #include <cctype>  // tolower
+#include <cerrno>  // errno
 #include <cstddef> // size_t
+#include <cstdint> // uint32_t
 #include <cstdio>  // fprintf, printf, stderr
+#include <cstring> // memmem, memmove
+#include <fcntl.h> // AT_FDCWD, AT_SYMLINK_NOFOLLOW, open
 #include <filesystem>
 #include <functional> // function
-#include <pwd.h>      // getpwnam
+#include <iterator>   // make_move_iterator
+#include <map>
+#include <pwd.h> // getpwnam
 #include <string>
-#include <system_error> // error_code
-#include <unistd.h>     // geteuid, getlogin, setegid, seteuid
+#include <string_view>
+#include <sys/fsuid.h>  // setfsgid, setfsuid
+#include <sys/stat.h>   // lstat, utimensat
+#include <sys/types.h>  // dev_t, ssize_t
+#include <system_error> // error_code, generic_category
+#include <unistd.h>     // close, geteuid, getlogin, read, unlink
+#include <unordered_set>
+#include <utility> // pair
 #include <vector>
 
 #include "ruc/file.h"
 #include "ruc/meta/assert.h"
 
+#include "cache.h"
 #include "config.h"
+#include "copier.h"
 #include "dotfile.h"
+#include "executor.h"
 #include "machine.h"
+#include "mappedfile.h"
+#include "matcher.h"
+#include "uring.h"
+#include "walker.h"
 
 Dotfile::Dotfile(s)
 {
@@ -39,6 +60,9 @@ void Dotfile::add(const std::vector<std::string>& targets)
 		return;
 	}
 
+	// Adding changes the working directory, so a snapshot of it would be outdated
+	Config::the().takeSnapshot();
+
 	std::vector<size_t> noExistIndices;
 	std::vector<size_t> homeIndices;
 	std::vector<size_t> systemIndices;
@@ -52,7 +76,7 @@ void Dotfile::add(const std::vector<std::string>& targets)
 			continue;
 		}
 
-		if (match(targets.at(i), Config::the().systemPatterns())) {
+		if (match(targets.at(i), Config::the().systemMatcher())) {
 			systemIndices.push_back(i);
 		}
 		else {
@@ -107,132 +131,22 @@ void Dotfile::push(const std::vector<std::string>& targets)
 }
 
 bool Dotfile::match(const std::string& path, const std::vector<std::string>& patterns)
+{
+	return match(path, Matcher(patterns));
+}
+
+bool Dotfile::match(const std::string& path, const Matcher& matcher)
 {
 	VERIFY(path.front() == '/', "path is not absolute: '{}'", path);
 
 	// Cut off working directory
-	size_t cutFrom = path.find(Config::the().workingDirectory()) == 0 ? Config::the().workingDirectorySize() : 0;
-	std::string pathString = path.substr(cutFrom);
-
-	for (const auto& pattern : patterns) {
-		// A dot matches everything in the current working directory
-		if (pattern == ".") {
-			return true;
-		}
-
-		// Exact match is obviously true
-		if (pathString == pattern) {
-			return true;
-		}
-
-		// If starts with '/', only match in the working directory root
-		bool onlyMatchInRoot = false;
-		if (pattern.front() == '/') {
-			onlyMatchInRoot = true;
-		}
-
-		// If ends with '/', only match directories
-		bool onlyMatchDirectories = false;
-		if (pattern.back() == '/') {
-			onlyMatchDirectories = true;
-		}
-
-		// Parsing
-
-		bool tryPatternState = true;
-
-		size_t pathIterator = 0;
-		size_t patternIterator = 0;
-
-		if (!onlyMatchInRoot) {
-			pathIterator++;
-		}
-
-		// Current path charter 'x' == next ignore pattern characters '*x'
-		// Example, iterator at []: [.]log/output.txt
-		//                          [*].log
-		if (pathIterator < pathString.length()
-		    && patternIterator < pattern.length() - 1
-		    && pattern.at(patternIterator) == '*'
-		    && pathString.at(pathIterator) == pattern.at(patternIterator + 1)) {
-			patternIterator++;
-		}
-
-		for (; pathIterator < pathString.length() && patternIterator < pattern.length();) {
-			char character = pathString.at(pathIterator);
-			pathIterator++;
-
-			if (!tryPatternState && character == '/') {
-				tryPatternState = true;
-				continue;
-			}
-
-			if (!tryPatternState) {
-				continue;
-			}
-
-			if (character == pattern.at(patternIterator)) {
-				// Fail if the final match hasn't reached the end of the ignore pattern
-				// Example, iterator at []: doc/buil[d]
-				//                          buil[d]/
-				if (pathIterator == pathString.length() && patternIterator < pattern.length() - 1) {
-					break;
-				}
-
-				// Next path character 'x' == next ignore pattern characters '*x', skip the '*'
-				// Example, iterator at []: /includ[e]/header.h
-				//                          /includ[e]*/
-				if (pathIterator < pathString.length()
-				    && patternIterator < pattern.length() - 2
-				    && pattern.at(patternIterator + 1) == '*'
-				    && pathString.at(pathIterator) == pattern.at(patternIterator + 2)) {
-					patternIterator++;
-				}
-
-				patternIterator++;
-				continue;
-			}
-
-			if (pattern.at(patternIterator) == '*') {
-				// Fail if we're entering a subdirectory and we should only match in the root
-				// Example, iterator at []: /src[/]include/header.h
-				//                          /[*]include/
-				if (onlyMatchInRoot && character == '/') {
-					break;
-				}
-
-				// Next path character == next ignore pattern character
-				if (pathIterator < pathString.length()
-				    && patternIterator + 1 < pattern.length()
-				    && pathString.at(pathIterator) == pattern.at(patternIterator + 1)) {
-					patternIterator++;
-				}
-
-				continue;
-			}
-
-			// Reset filter pattern if it hasnt been completed at this point
-			// Example, iterator at []: /[s]rc/include/header.h
-			//                          /[i]nclude*/
-			if (patternIterator < pattern.length() - 1) {
-				patternIterator = 0;
-			}
-
-			tryPatternState = false;
-		}
-
-		if (patternIterator == pattern.length()) {
-			return true;
-		}
-		if (pattern.back() == '*' && patternIterator == pattern.length() - 1) {
-			return true;
-		}
-		if (onlyMatchDirectories && patternIterator == pattern.length() - 1) {
-			return true;
-		}
+	std::string_view pathView = path;
+	const auto& config = Config::the();
+	if (pathView.starts_with(config.workingDirectory().native())) {
+		pathView.remove_prefix(config.workingDirectorySize());
 	}
 
-	return false;
+	return matcher.match(pathView);
 }
 
 // -----------------------------------------
@@ -246,7 +160,7 @@ void Dotfile::pullOrPush(SyncType type, const std::vector<std::string>& targets)
 	// Separate home and system targets
 	forEachDotfile(targets, [&](const std::filesystem::directory_entry& path, size_t index) {
 		dotfiles.push_back(path.path().string());
-		if (match(path.path().string(), Config::the().systemPatterns())) {
+		if (match(path.path().string(), Config::the().systemMatcher())) {
 			systemIndices.push_back(index);
 		}
 		else {
@@ -301,86 +215,439 @@ void Dotfile::sync(SyncType type,
 		}
 	}
 
-	auto printError = [](const std::filesystem::path& path, const std::error_code& error) -> void {
+	// State of a thread in the pool, errors are reported once all copies are done
+	// The copies are only moved over their destinations once all of them are
+	// flushed to disk, together with the task they belong to
+	struct Worker {
+		Copier copier { true };
+		bool unprivileged { false };
+		std::unordered_set<std::string> directories;
+		std::vector<std::pair<size_t, Copier::Pending>> renames;
+		std::unordered_set<std::string> renamed;
+		std::vector<std::pair<size_t, std::string>> errors;
+	};
+
+	auto collectError = [](Worker& worker, size_t task, const std::filesystem::path& path, const std::error_code& error) -> void {
 		if (error.value() && error.message() != "File exists") {
-			fprintf(stderr, "\033[31;1mDotfile:\033[0m '%s': %c%s\n",
-			        path.c_str(),
-			        tolower(error.message().c_str()[0]),
-			        error.message().c_str() + 1);
+			std::string message = error.message();
+			message[0] = tolower(message[0]);
+			worker.errors.emplace_back(task, "'" + path.string() + "': " + message);
 		}
 	};
 
-	const auto copyOptions = std::filesystem::copy_options::overwrite_existing
-	                         | std::filesystem::copy_options::recursive
-	                         | std::filesystem::copy_options::copy_symlinks;
+	// Resolved before the workers start, so they only read them
+	const uint32_t uid = Machine::the().uid();
+	const uint32_t gid = Machine::the().gid();
+	const bool verbose = Config::the().verbose();
+	const Config::Deploy deploy = Config::the().deploy();
 
-	auto copy = [&root, &printError](const std::filesystem::path& from,
-	                                 const std::filesystem::path& to, bool homePath) -> void {
-		if (homePath && root) {
-			setegid(Machine::the().gid());
-			seteuid(Machine::the().uid());
+	std::atomic<size_t> copied { 0 };
+	std::atomic<size_t> skipped { 0 };
+
+	// Status of the source and destination of every task, when fetched in a batch
+	bool prefetched = false;
+	std::vector<struct stat> statuses;
+	std::vector<int> statusErrors;
+
+	// Check if the destination already holds the source, via the target of
+	// a symlink or the size and modification time of a file
+	auto unchanged = [](const std::filesystem::path& from, const struct stat& fromStatus,
+	                    const std::filesystem::path& to, const struct stat& toStatus) -> bool {
+		// A home file deployed as a symlink points back at the working directory
+		if (S_ISLNK(fromStatus.st_mode) && S_ISREG(toStatus.st_mode)) {
+			std::error_code error;
+			return std::filesystem::read_symlink(from, error) == to && !error;
 		}
 
-		// Create directory for the file
-		std::error_code error;
-		if (std::filesystem::is_regular_file(from) || std::filesystem::is_symlink(from)) {
+		if ((fromStatus.st_mode & S_IFMT) != (toStatus.st_mode & S_IFMT)) {
+			return false;
+		}
+
+		if (S_ISLNK(fromStatus.st_mode)) {
+			std::error_code error;
+			auto target = std::filesystem::read_symlink(from, error);
+			return !error && target == std::filesystem::read_symlink(to, error) && !error;
+		}
+
+		return S_ISREG(fromStatus.st_mode)
+		       && fromStatus.st_mode == toStatus.st_mode
+		       && fromStatus.st_size == toStatus.st_size
+		       && fromStatus.st_mtim.tv_sec == toStatus.st_mtim.tv_sec
+		       && fromStatus.st_mtim.tv_nsec == toStatus.st_mtim.tv_nsec;
+	};
+
+	// Filesystem credentials only apply to the calling thread, unlike
+	// setegid/seteuid which change the credentials of the whole process
+	auto setUnprivileged = [&](Worker& worker, bool unprivileged) -> void {
+		if (!root || worker.unprivileged == unprivileged) {
+			return;
+		}
+		if (unprivileged) {
+			setfsgid(gid);
+			setfsuid(uid);
+		}
+		else {
+			setfsuid(0);
+			setfsgid(0);
+		}
+		worker.unprivileged = unprivileged;
+	};
+
+	auto copy = [&](Worker& worker, size_t task, const std::filesystem::path& from,
+	                std::filesystem::path to, bool homePath) -> void {
+		// Credentials only change when a worker moves from the home batch to the system batch
+		setUnprivileged(worker, homePath);
+
+		// Every source and destination is stat'ed once
+		struct stat fromStatus;
+		struct stat toStatus;
+		int fromError = 0;
+		bool toExists;
+		if (prefetched) {
+			fromStatus = statuses.at(task * 2);
+			toStatus = statuses.at(task * 2 + 1);
+			fromError = statusErrors.at(task * 2);
+			toExists = statusErrors.at(task * 2 + 1) == 0;
+		}
+		else {
+			fromError = lstat(from.c_str(), &fromStatus) == 0 ? 0 : errno;
+			toExists = lstat(to.c_str(), &toStatus) == 0;
+		}
+
+		std::error_code error(fromError, std::generic_category());
+		if (error) {
+			collectError(worker, task, from, error);
+			return;
+		}
+
+		// Home files are deployed as links into the working directory, if enabled
+		// Symlinks carry the modification time of the source, so they are only
+		// checked again after the source has changed
+		// A hardlink is the source itself, so it is always scanned for blocks
+		bool link = deploy != Config::Deploy::Copy && type == SyncType::Push && homePath && S_ISREG(fromStatus.st_mode);
+		bool linked = false;
+		if (link && toExists) {
+			std::error_code linkError;
+			linked = deploy == Config::Deploy::Symlink
+			             ? S_ISLNK(toStatus.st_mode) && std::filesystem::read_symlink(to, linkError) == from && !linkError
+			             : toStatus.st_dev == fromStatus.st_dev && toStatus.st_ino == fromStatus.st_ino;
+			if (linked
+			    && deploy == Config::Deploy::Symlink
+			    && fromStatus.st_mtim.tv_sec == toStatus.st_mtim.tv_sec
+			    && fromStatus.st_mtim.tv_nsec == toStatus.st_mtim.tv_nsec) {
+				skipped++;
+				return;
+			}
+		}
+
+		// Destinations like /etc/resolv.conf can be symlinks, write to their target
+		if (toExists && !link && S_ISREG(fromStatus.st_mode)) {
+			Copier::followSymlink(to, toStatus, fromStatus);
+		}
+
+		if (toExists && !link && unchanged(from, fromStatus, to, toStatus)) {
+			skipped++;
+			return;
+		}
+
+		// Files are scanned for blocks when pushing, only the files that have
+		// them are read to be selectively commented on the way to the
+		// destination, the others are copied
+		std::string contents;
+		bool read = false;
+		if (S_ISREG(fromStatus.st_mode)) {
+			bool marked = false;
+			if (type == SyncType::Push) {
+				marked = containsBlocks(from, fromStatus.st_size, error);
+				if (error) {
+					collectError(worker, task, from, error);
+					return;
+				}
+			}
+
+			// Only files without blocks are linked, the others are rendered and
+			// copied, which replaces a hardlink to the source
+			link = link && !marked;
+			if (link && linked) {
+				if (deploy == Config::Deploy::Symlink) {
+					const struct timespec times[2] = { { 0, UTIME_OMIT }, fromStatus.st_mtim };
+					utimensat(AT_FDCWD, to.c_str(), times, AT_SYMLINK_NOFOLLOW);
+				}
+				skipped++;
+				return;
+			}
+
+			if (marked) {
+				if (!worker.copier.read(from, fromStatus, contents, error)) {
+					collectError(worker, task, from, error);
+					return;
+				}
+				selectivelyCommentOrUncomment(contents);
+				read = true;
+			}
+
+			// Compare with a destination of the same size through mappings of both files
+			bool comparable = toExists && S_ISREG(toStatus.st_mode) && fromStatus.st_mode == toStatus.st_mode;
+			size_t size = read ? contents.size() : static_cast<size_t>(fromStatus.st_size);
+			if (!link && comparable && static_cast<size_t>(toStatus.st_size) == size) {
+				MappedFile destination(to);
+				if (destination.valid()
+				    && (read ? std::string_view(contents) : MappedFile(from).data()) == destination.data()) {
+					skipped++;
+					return;
+				}
+			}
+		}
+
+		// Create directory for the file, each directory is checked once per worker
+		if (!toExists && (S_ISREG(fromStatus.st_mode) || S_ISLNK(fromStatus.st_mode))) {
 			auto directory = to.parent_path();
-			if (!directory.empty() && !std::filesystem::exists(directory)) {
-				if (Config::the().verbose()) {
+			if (!directory.empty() && worker.directories.insert(directory.string()).second) {
+				if (std::filesystem::create_directories(directory, error) && verbose) {
 					printf("Created directory: '%s'\n", directory.c_str());
 				}
-				std::filesystem::create_directories(directory, error);
-				printError(to.relative_path().parent_path(), error);
+				collectError(worker, task, to.relative_path().parent_path(), error);
 			}
 		}
 
 		// Copy the file or directory
-		if (Config::the().verbose()) {
+		if (verbose) {
 			printf("'%s' -> '%s'\n", from.c_str(), to.c_str());
 		}
-		if (std::filesystem::is_symlink(from)) {
-			// NOTE: std::filesystem::copy doesnt respect 'overwrite_existing' for symlinks
-			std::filesystem::remove(to, error);
-			printError(to, error);
-			std::filesystem::copy_symlink(from, to, error);
-			printError(from, error);
+		const struct stat* destination = toExists ? &toStatus : nullptr;
+		if (link) {
+			worker.copier.link(from, fromStatus, to, destination, deploy == Config::Deploy::Symlink, error);
+			// Hardlinks cant cross filesystems or may be refused by protected_hardlinks, copy those instead
+			if (error.value() == EXDEV || error.value() == EPERM) {
+				link = false;
+			}
+			else {
+				collectError(worker, task, to, error);
+			}
 		}
-		else {
-			std::filesystem::copy(from, to, copyOptions, error);
-			printError(from, error);
+		if (!link && read) {
+			// Rendered files are written to the destination from memory
+			worker.copier.write(to, destination, contents, fromStatus.st_mode, error);
+			collectError(worker, task, to, error);
+		}
+		else if (!link) {
+			worker.copier.copy(from, fromStatus, to, destination, error);
+			collectError(worker, task, from, error);
+		}
+
+		// Keep the modification time of plain copies and links, so the next sync can skip them cheaply
+		// Rendered files get one just before it, even when rendering left them
+		// as-is, so they are never skipped by it, their contents also depend on
+		// the machine facts that can change in between
+		auto pending = worker.copier.takePending();
+		if (!error && S_ISREG(fromStatus.st_mode)) {
+			struct timespec modified = fromStatus.st_mtim;
+			if (read && modified.tv_nsec > 0) {
+				modified.tv_nsec--;
+			}
+			else if (read) {
+				modified.tv_sec--;
+				modified.tv_nsec = 999999999;
+			}
+			const struct timespec times[2] = { { 0, UTIME_OMIT }, modified };
+			utimensat(AT_FDCWD, pending.empty() ? to.c_str() : pending.back().temporary.c_str(), times, AT_SYMLINK_NOFOLLOW);
 		}
-
-		if (homePath && root) {
-			seteuid(0);
-			setegid(0);
+		for (auto& entry : pending) {
+			worker.renames.emplace_back(task, std::move(entry));
 		}
+
+		copied++;
+	};
+
+	struct Task {
+		std::string from;
+		std::string to;
+		bool homePath;
 	};
+	std::vector<Task> tasks;
+	tasks.reserve(homeIndices.size() + systemIndices.size());
 
+	// The tasks are handed out in order, so every worker runs part of the
+	// home batch before it reaches the system batch
 	// /home/<user>/
 	std::string homeDirectory = "/home/" + Machine::the().username();
 	for (size_t i : homeIndices) {
 		std::string homePaths[2];
 		generateHomePaths(homePaths, paths.at(i), homeDirectory);
-		copy(homePaths[0], homePaths[1], true);
-		if (type == SyncType::Push) {
-			selectivelyCommentOrUncomment(homePaths[1]);
-		}
+		tasks.push_back({ std::move(homePaths[0]), std::move(homePaths[1]), true });
 	}
 	// /
 	for (size_t i : systemIndices) {
 		std::string systemPaths[2];
 		generateSystemPaths(systemPaths, paths.at(i));
-		copy(systemPaths[0], systemPaths[1], false);
-		if (type == SyncType::Push) {
-			selectivelyCommentOrUncomment(systemPaths[1]);
+		tasks.push_back({ std::move(systemPaths[0]), std::move(systemPaths[1]), false });
+	}
+
+	// Stat every source and destination up front, many per syscall when io_uring is available
+	// NOTE: This runs with the credentials of the caller, the copies still check access as the user
+	if (tasks.size() >= 64) {
+		Uring uring;
+		if (uring.available()) {
+			std::vector<std::string> statusPaths;
+			statusPaths.reserve(tasks.size() * 2);
+			for (const auto& task : tasks) {
+				statusPaths.push_back(task.from);
+				statusPaths.push_back(task.to);
+			}
+			uring.lstat(statusPaths, statuses, statusErrors);
+			prefetched = true;
+		}
+	}
+
+	// The directories that get copies are recorded until these are renamed, so
+	// the next run can remove the copies left behind when this one is killed
+	auto journal = Cache::directory() / "deploying";
+	auto stale = Cache::read(journal);
+	if (stale.has_value()) {
+		std::string_view data = stale.value();
+		for (size_t end = data.find('\n'); end != std::string_view::npos; data.remove_prefix(end + 1), end = data.find('\n')) {
+			Copier::removeStale(std::string(data.substr(0, end)));
+		}
+	}
+	std::string directories;
+	std::unordered_set<std::string> recorded;
+	std::filesystem::path workingDirectory;
+	for (const auto& task : tasks) {
+		std::filesystem::path directory = std::filesystem::path(task.to).parent_path();
+		if (directory.is_relative()) {
+			if (workingDirectory.empty()) {
+				workingDirectory = std::filesystem::current_path();
+			}
+			directory = workingDirectory / directory;
+		}
+		if (recorded.insert(directory.string()).second) {
+			directories.append(directory.string() + '\n');
+		}
+	}
+	bool journaled = Cache::write(journal, directories);
+
+	Executor executor(Config::the().threads());
+	std::vector<Worker> workers(executor.threads());
+	executor.run(tasks.size(), [&](size_t index, size_t worker) {
+		const auto& task = tasks.at(index);
+		copy(workers.at(worker), index, task.from, task.to, task.homePath);
+	});
+
+	// Worker 0 is the calling thread, the other threads have exited
+	// The threads of the next run start with the credentials of the calling thread
+	setUnprivileged(workers.front(), false);
+	for (auto& worker : workers) {
+		worker.unprivileged = false;
+	}
+
+	// Make the copies durable with one sync per filesystem, instead of one per file
+	std::map<dev_t, std::filesystem::path> filesystems;
+	for (const auto& worker : workers) {
+		filesystems.insert(worker.copier.filesystems().begin(), worker.copier.filesystems().end());
+	}
+	bool synced = true;
+	for (const auto& [device, directory] : filesystems) {
+		std::error_code error;
+		synced = Copier::syncFilesystem(directory, error) && synced;
+		collectError(workers.front(), tasks.size(), directory, error);
+	}
+
+	// Only then replace the destinations, with the credentials of their task
+	// Copies that may not be on disk are removed instead, keeping the old files
+	executor.run(workers.size(), [&](size_t index, size_t worker) {
+		auto& state = workers.at(worker);
+		for (const auto& [task, pending] : workers.at(index).renames) {
+			if (!synced) {
+				Copier::discard(pending);
+				continue;
+			}
+			setUnprivileged(state, tasks.at(task).homePath);
+			std::error_code error;
+			Copier::rename(pending, error);
+			collectError(state, task, pending.to, error);
+			state.renamed.insert(pending.to.parent_path().string());
 		}
+	});
+	setUnprivileged(workers.front(), false);
+
+	// Make the renames durable, once per directory
+	std::unordered_set<std::string> renamed;
+	for (const auto& worker : workers) {
+		renamed.insert(worker.renamed.begin(), worker.renamed.end());
+	}
+	for (const auto& directory : renamed) {
+		std::error_code error;
+		Copier::syncDirectory(directory.empty() ? "." : directory, error);
+		collectError(workers.front(), tasks.size(), directory, error);
+	}
+	if (journaled || stale.has_value()) {
+		unlink(journal.c_str());
+	}
+
+	// Report the errors in the order of the tasks
+	std::vector<std::pair<size_t, std::string>> errors;
+	for (auto& worker : workers) {
+		errors.insert(errors.end(), worker.errors.begin(), worker.errors.end());
+	}
+	std::sort(errors.begin(), errors.end());
+	for (const auto& error : errors) {
+		fprintf(stderr, "\033[31;1mDotfile:\033[0m %s\n", error.second.c_str());
 	}
+
+	printf("%zu copied, %zu skipped as unchanged\n", copied.load(), skipped.load());
 }
 
-void Dotfile::selectivelyCommentOrUncomment(const std::string& path)
+bool Dotfile::containsBlocks(const std::filesystem::path& path, size_t size, std::error_code& error)
 {
-	ruc::File dotfile(path);
+	error.clear();
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		error = std::error_code(errno, std::generic_category());
+		return false;
+	}
+
+	// Scan in bounded chunks, keeping the end of the previous chunk for a
+	// marker that is split over both
+	char buffer[2 + 64 * 1024];
+	size_t kept = 0;
+	size_t total = 0;
+	bool found = false;
+	for (;;) {
+		ssize_t result = ::read(fd, buffer + kept, sizeof(buffer) - kept);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result < 0) {
+			error = std::error_code(errno, std::generic_category());
+			break;
+		}
+		if (result == 0) {
+			break;
+		}
+
+		size_t length = kept + result;
+		if (memmem(buffer, length, ">>>", 3) != nullptr) {
+			found = true;
+			break;
+		}
 
+		// Files that report no size, like the ones in /proc, are read until the end
+		total += result;
+		if (size > 0 && total >= size) {
+			break;
+		}
+
+		kept = std::min<size_t>(length, 2);
+		memmove(buffer, buffer + length - kept, kept);
+	}
+
+	close(fd);
+	return found;
+}
+
+bool Dotfile::selectivelyCommentOrUncomment(std::string& dotfile)
+{
 	const std::string search[4] = {
 		"distro=",
 		"hostname=",
@@ -388,61 +655,119 @@ void Dotfile::selectivelyCommentOrUncomment(const std::string& path)
 		"session=",
 	};
 
+	// Files without blocks are left alone, most dotfiles dont have any
+	auto findMarker = [&dotfile](size_t position) -> size_t {
+		const void* marker = memmem(dotfile.data() + position, dotfile.size() - position, ">>>", 3);
+		return (marker != nullptr) ? static_cast<const char*>(marker) - dotfile.data() : std::string::npos;
+	};
+	if (findMarker(0) == std::string::npos) {
+		return false;
+	}
+
+	// Machine values are looked up once a filter needs them, detecting the
+	// session scans the running processes
+	using Fact = const std::string& (Machine::*)() const;
+	const Fact facts[4] = {
+		&Machine::distroId,
+		&Machine::hostname,
+		&Machine::username,
+		&Machine::session,
+	};
+	const std::string* machine[4] { nullptr, nullptr, nullptr, nullptr };
+	auto machineValue = [&facts, &machine](size_t i) -> const std::string& {
+		if (machine[i] == nullptr) {
+			machine[i] = &(Machine::the().*facts[i])();
+		}
+		return *machine[i];
+	};
+
 	// State of the loop
 	bool isFiltering = false;
 	std::string filter[4];
 	std::string commentCharacter;
 	std::string commentTerminationCharacter;
-	size_t positionInFile = 0;
+	bool changed = false;
+
+	// The file is written to a new buffer in a single pass
+	std::string output;
+	output.reserve(dotfile.size() + dotfile.size() / 8);
 
-	auto commentOrUncommentLine = [&](std::string& line, bool addComment) {
+	auto commentOrUncommentLine = [&](std::string_view line, bool addComment) {
 		size_t indentation = line.find_first_not_of(" \t");
 
 		// Empty lines are skipped
-		if (line.empty() || indentation == std::string::npos) {
+		if (line.empty() || indentation == std::string_view::npos) {
+			output.append(line);
 			return;
 		}
 
-		size_t lineLength = line.size();
 		size_t commentStart = line.find(commentCharacter, indentation);
 		size_t commentEnd = line.rfind(commentTerminationCharacter);
-		bool hasComment = commentStart != std::string::npos && (commentTerminationCharacter.empty() || commentEnd != std::string::npos);
+		bool hasComment = commentStart != std::string_view::npos && (commentTerminationCharacter.empty() || commentEnd != std::string_view::npos);
 
 		// Lines that have a comment at the *end* of the line aren't considered commented lines
-		if (hasComment && line.find_first_not_of(" \t") < commentStart) {
+		if (hasComment && indentation < commentStart) {
 			hasComment = false;
 		}
 
+		size_t outputSize = output.size();
+
 		// Uncomment line
 		if (hasComment && !addComment) {
 			size_t contentStart = line.find_first_not_of(" \t", commentStart + commentCharacter.size());
-			size_t contentLength = commentEnd - contentStart;
+			std::string_view content;
+			if (contentStart != std::string_view::npos) {
+				content = line.substr(contentStart, commentEnd - contentStart);
+			}
 
 			// Trim trailing whitespace
-			std::string content = line.substr(contentStart, contentLength);
 			content = content.substr(0, content.find_last_not_of(" \t") + 1);
 
-			line = line.substr(0, indentation)
-			       + content;
+			output.append(line.substr(0, indentation));
+			output.append(content);
 		}
 		// Comment line
 		else if (!hasComment && addComment) {
-			size_t contentStart = line.find_first_not_of(" \t");
-			size_t contentLength = line.size() - contentStart;
-
-			line = line.substr(0, indentation)
-			       + commentCharacter + ' '
-			       + line.substr(contentStart, contentLength)
-			       + (!commentTerminationCharacter.empty() ? ' ' + commentTerminationCharacter : "");
+			output.append(line.substr(0, indentation));
+			output.append(commentCharacter);
+			output.push_back(' ');
+			output.append(line.substr(indentation));
+			if (!commentTerminationCharacter.empty()) {
+				output.push_back(' ');
+				output.append(commentTerminationCharacter);
+			}
+		}
+		else {
+			output.append(line);
+			return;
 		}
 
-		dotfile.replace(positionInFile, lineLength, line);
+		if (std::string_view(output).substr(outputSize) != line) {
+			changed = true;
+		}
 	};
 
-	std::istringstream stream(dotfile.data());
-	for (std::string line; std::getline(stream, line); positionInFile += line.size() + 1) {
+	const std::string_view file(dotfile);
+	for (size_t lineStart = 0; lineStart < file.size();) {
+		// Outside of blocks, copy everything up to the line of the next marker
+		if (!isFiltering) {
+			size_t marker = findMarker(lineStart);
+			if (marker == std::string::npos) {
+				output.append(file.substr(lineStart));
+				break;
+			}
 
-		if (line.find(">>>") != std::string::npos) {
+			size_t markerLine = file.rfind('\n', marker);
+			markerLine = (markerLine != std::string_view::npos && markerLine >= lineStart) ? markerLine + 1 : lineStart;
+			output.append(file.substr(lineStart, markerLine - lineStart));
+			lineStart = markerLine;
+		}
+
+		size_t lineEnd = file.find('\n', lineStart);
+		std::string_view line = file.substr(lineStart, lineEnd - lineStart);
+		lineStart = (lineEnd != std::string_view::npos) ? lineEnd + 1 : file.size();
+
+		if (line.find(">>>") != std::string_view::npos) {
 			// Find machine info
 			size_t find = 0;
 			for (size_t i = 0; i < 4; ++i) {
@@ -471,10 +796,9 @@ void Dotfile::selectivelyCommentOrUncomment(const std::string& path)
 			}
 
 			isFiltering = true;
-			continue;
+			output.append(line);
 		}
-
-		if (line.find("<<<") != std::string::npos) {
+		else if (line.find("<<<") != std::string_view::npos) {
 			isFiltering = false;
 			filter[0] = "";
 			filter[1] = "";
@@ -482,51 +806,80 @@ void Dotfile::selectivelyCommentOrUncomment(const std::string& path)
 			filter[3] = "";
 			commentCharacter.clear();
 			commentTerminationCharacter.clear();
-			continue;
-		}
-
-		if (!isFiltering) {
-			continue;
+			output.append(line);
 		}
-
-		if (filter[0] != Machine::the().distroId() && !filter[0].empty()) {
-			commentOrUncommentLine(line, true);
-			continue;
-		}
-		else if (filter[1] != Machine::the().hostname() && !filter[1].empty()) {
-			commentOrUncommentLine(line, true);
-			continue;
+		else if (!isFiltering) {
+			output.append(line);
 		}
-		else if (filter[2] != Machine::the().username() && !filter[2].empty()) {
-			commentOrUncommentLine(line, true);
-			continue;
+		else {
+			// Comment the line if any of the filters doesnt match this machine
+			bool addComment = false;
+			for (size_t i = 0; i < 4; ++i) {
+				if (!filter[i].empty() && filter[i] != machineValue(i)) {
+					addComment = true;
+					break;
+				}
+			}
+			commentOrUncommentLine(line, addComment);
 		}
-		else if (filter[3] != Machine::the().session() && !filter[3].empty()) {
-			commentOrUncommentLine(line, true);
-			continue;
+
+		if (lineEnd != std::string_view::npos) {
+			output.push_back('\n');
 		}
+	}
 
-		commentOrUncommentLine(line, false);
+	if (changed) {
+		dotfile = std::move(output);
 	}
 
-	dotfile.flush();
+	return changed;
 }
 
 void Dotfile::forEachDotfile(const std::vector<std::string>& targets, const std::function<void(const std::filesystem::directory_entry&, size_t)>& callback)
 {
+	Matcher targetMatcher(targets);
+
+	// Ignore pattern check, skip the whole subtree without listing it
+	auto descend = [this](const std::filesystem::directory_entry& directory) -> bool {
+		return !match(directory.path().string() + '/', Config::the().ignoreMatcher());
+	};
+
+	// Continue the walk done by config file discovery, if there was one
+	// Without it, the config was found with a single stat and this is the only walk
+	Walker walker(Config::the().threads());
+	std::vector<std::filesystem::directory_entry> entries;
+	auto snapshot = Config::the().takeSnapshot();
+	if (snapshot.has_value()) {
+		entries = std::move(snapshot->entries);
+
+		std::vector<std::filesystem::path> unvisited;
+		for (auto& directory : snapshot->unvisitedDirectories) {
+			if (descend(std::filesystem::directory_entry(directory))) {
+				unvisited.push_back(std::move(directory));
+			}
+		}
+
+		auto rest = walker.walk(unvisited, descend);
+		size_t middle = entries.size();
+		entries.insert(entries.end(), std::make_move_iterator(rest.begin()), std::make_move_iterator(rest.end()));
+		std::inplace_merge(entries.begin(), entries.begin() + middle, entries.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.path() < rhs.path();
+		});
+	}
+	else {
+		entries = walker.walk(Config::the().workingDirectory(), descend);
+	}
+
 	size_t index = 0;
-	for (const auto& path : std::filesystem::recursive_directory_iterator { Config::the().workingDirectory() }) {
+	for (const auto& path : entries) {
 		std::string pathString = path.path().string();
 
-		if (path.is_directory()) {
-			continue;
-		}
 		// Ignore pattern check
-		if (match(pathString, Config::the().ignorePatterns())) {
+		if (match(pathString, Config::the().ignoreMatcher())) {
 			continue;
 		}
 		// Include check
-		if (!targets.empty() && !match(pathString, targets)) {
+		if (!targets.empty() && !match(pathString, targetMatcher)) {
 			continue;
 		}
 		callback(path, index++);
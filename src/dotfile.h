@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2021-2022 Riyyi
+ * Copyright (C) 2021-2022,2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
@@ -11,10 +11,13 @@
 #include <filesystem>
 #include <functional> // function
 #include <string>
+#include <system_error> // error_code
 #include <vector>
 
 #include "ruc/singleton.h"
 
+#include "matcher.h"
+
 class Dotfile : public ruc::Singleton<Dotfile> {
 public:
 	Dotfile(s);
@@ -32,6 +35,7 @@ public:
 	void push(const std::vector<std::string>& targets = {});
 
 	bool match(const std::string& path, const std::vector<std::string>& patterns);
+	bool match(const std::string& path, const Matcher& matcher);
 
 private:
 	void pullOrPush(SyncType type, const std::vector<std::string>& targets = {});
@@ -39,7 +43,8 @@ private:
 	          const std::vector<std::string>& paths, const std::vector<size_t>& homeIndices, const std::vector<size_t>& systemIndices,
 	          const std::function<void(std::string*, const std::string&, const std::string&)>& generateHomePaths,
 	          const std::function<void(std::string*, const std::string&)>& generateSystemPaths);
-	void selectivelyCommentOrUncomment(const std::string& path);
+	static bool containsBlocks(const std::filesystem::path& path, size_t size, std::error_code& error);
+	bool selectivelyCommentOrUncomment(std::string& dotfile);
 
 	void forEachDotfile(const std::vector<std::string>& targets, const std::function<void(const std::filesystem::directory_entry&, size_t)>& callback);
 };
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm> // sort, unique
+#include <cstddef>   // size_t
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error> // error_code
+#include <unordered_set>
+#include <utility> // pair
+#include <vector>
+#include <zlib.h> // gzclose, gzeof, gzgets, gzopen
+
+#include "dpkg.h"
+#include "mappedfile.h"
+
+Dpkg::Dpkg(const std::filesystem::path& root)
+	: m_root(root)
+{
+}
+
+// -----------------------------------------
+
+bool Dpkg::manualPackages(std::vector<std::string>& packages) const
+{
+	packages.clear();
+
+	MappedFile status(m_root / "var/lib/dpkg/status");
+	if (!status.valid()) {
+		return false;
+	}
+
+	auto automatic = automaticPackages();
+	auto history = historyPackages();
+
+	// A single pass over the status file
+	forEachStanza(status.data(), [&](const auto& fields) {
+		std::string_view name;
+		std::string_view state;
+		std::string_view priority;
+		for (const auto& [field, value] : fields) {
+			if (field == "Package") {
+				name = value;
+			}
+			else if (field == "Status") {
+				state = value;
+			}
+			else if (field == "Priority") {
+				priority = value;
+			}
+		}
+
+		// Status: install ok installed
+		if (name.empty() || !state.ends_with(" installed")) {
+			return;
+		}
+		if (priority == "required" || priority == "important" || priority == "standard") {
+			return;
+		}
+
+		std::string package(name);
+		if (automatic.find(package) == automatic.end() || history.find(package) != history.end()) {
+			packages.push_back(std::move(package));
+		}
+	});
+
+	// Packages of multiple architectures have a stanza each
+	std::sort(packages.begin(), packages.end());
+	packages.erase(std::unique(packages.begin(), packages.end()), packages.end());
+
+	return true;
+}
+
+void Dpkg::forEachStanza(std::string_view file, const StanzaCallback& callback)
+{
+	std::vector<std::pair<std::string_view, std::string_view>> fields;
+
+	size_t valueStart = 0;
+	for (size_t lineStart = 0; lineStart <= file.size();) {
+		size_t lineEnd = file.find('\n', lineStart);
+		if (lineEnd == std::string_view::npos) {
+			lineEnd = file.size();
+		}
+		std::string_view line = file.substr(lineStart, lineEnd - lineStart);
+
+		// Stanzas are separated by empty lines
+		if (line.empty()) {
+			if (!fields.empty()) {
+				callback(fields);
+				fields.clear();
+			}
+		}
+		// Continuation of the value of the previous field
+		else if (line.front() == ' ' || line.front() == '\t') {
+			if (!fields.empty()) {
+				fields.back().second = file.substr(valueStart, lineEnd - valueStart);
+			}
+		}
+		else {
+			size_t colon = line.find(':');
+			if (colon != std::string_view::npos) {
+				valueStart = line.find_first_not_of(" \t", colon + 1);
+				valueStart = (valueStart != std::string_view::npos) ? lineStart + valueStart : lineEnd;
+				fields.emplace_back(line.substr(0, colon), file.substr(valueStart, lineEnd - valueStart));
+			}
+		}
+
+		lineStart = lineEnd + 1;
+	}
+
+	if (!fields.empty()) {
+		callback(fields);
+	}
+}
+
+// -----------------------------------------
+
+std::unordered_set<std::string> Dpkg::automaticPackages() const
+{
+	std::unordered_set<std::string> packages;
+
+	MappedFile extendedStates(m_root / "var/lib/apt/extended_states");
+	forEachStanza(extendedStates.data(), [&packages](const auto& fields) {
+		std::string_view name;
+		bool automatic = false;
+		for (const auto& [field, value] : fields) {
+			if (field == "Package") {
+				name = value;
+			}
+			else if (field == "Auto-Installed") {
+				automatic = value == "1";
+			}
+		}
+
+		if (automatic && !name.empty()) {
+			packages.emplace(name);
+		}
+	});
+
+	return packages;
+}
+
+std::unordered_set<std::string> Dpkg::historyPackages() const
+{
+	std::unordered_set<std::string> packages;
+
+	// history.log, history.log.1 and history.log.2.gz etc. rotated by logrotate,
+	// zlib reads both plain and compressed files
+	std::error_code error;
+	auto iterator = std::filesystem::directory_iterator(m_root / "var/log/apt", error);
+	for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+		if (it->path().filename().string().find("history.log") != 0) {
+			continue;
+		}
+
+		gzFile file = gzopen(it->path().c_str(), "rb");
+		if (file == nullptr) {
+			continue;
+		}
+
+		std::string line;
+		char buffer[4096];
+		while (gzgets(file, buffer, sizeof(buffer)) != nullptr) {
+			// Lines longer than the buffer are read in parts
+			line.append(buffer);
+			if (!line.ends_with('\n') && !gzeof(file)) {
+				continue;
+			}
+
+			// Commandline: apt install <package>, as long as it isnt run by apt itself
+			std::string_view view(line);
+			view = view.substr(0, view.find_last_not_of(" \t\n") + 1);
+			if (view.starts_with("Commandline:")
+			    && view.find(" install ") != std::string_view::npos
+			    && view.find("APT::") == std::string_view::npos) {
+				packages.emplace(view.substr(view.find_last_of(" \t") + 1));
+			}
+			line.clear();
+		}
+
+		gzclose(file);
+	}
+
+	return packages;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional> // function
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility> // pair
+#include <vector>
+
+// Reads the dpkg and apt databases directly, instead of starting dpkg-query
+// and apt-mark
+class Dpkg {
+public:
+	// The databases are found relative to the root directory
+	explicit Dpkg(const std::filesystem::path& root = "/");
+
+	// Installed packages that were installed manually, either marked as such by
+	// apt or named on an apt install command line, excluding the packages with
+	// required, important or standard priority, sorted
+	// Returns false if the dpkg status file couldnt be read
+	bool manualPackages(std::vector<std::string>& packages) const;
+
+	// Call the callback with the fields of every stanza in a deb822 file,
+	// continuation lines are part of the value of their field
+	using StanzaCallback = std::function<void(const std::vector<std::pair<std::string_view, std::string_view>>& fields)>;
+	static void forEachStanza(std::string_view file, const StanzaCallback& callback);
+
+private:
+	// Packages marked Auto-Installed in /var/lib/apt/extended_states
+	std::unordered_set<std::string> automaticPackages() const;
+	// Packages named on the apt install command lines in /var/log/apt/history.log*
+	std::unordered_set<std::string> historyPackages() const;
+
+	std::filesystem::path m_root;
+};
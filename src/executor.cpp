@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm> // min
+#include <atomic>
+#include <cstddef> // size_t
+#include <thread>
+#include <vector>
+
+#include "executor.h"
+
+Executor::Executor(size_t threads)
+	: m_threads(threads != 0 ? threads : std::thread::hardware_concurrency())
+{
+	if (m_threads == 0) {
+		m_threads = 1;
+	}
+}
+
+// -----------------------------------------
+
+void Executor::run(size_t count, const Task& task) const
+{
+	std::atomic<size_t> next { 0 };
+
+	auto work = [&next, &count, &task](size_t worker) -> void {
+		for (size_t index = next++; index < count; index = next++) {
+			task(index, worker);
+		}
+	};
+
+	size_t threads = std::min(m_threads, count);
+	if (threads <= 1) {
+		work(0);
+		return;
+	}
+
+	std::vector<std::thread> pool;
+	pool.reserve(threads - 1);
+	for (size_t i = 1; i < threads; ++i) {
+		pool.emplace_back(work, i);
+	}
+	work(0);
+
+	for (auto& thread : pool) {
+		thread.join();
+	}
+}
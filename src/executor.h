@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>    // size_t
+#include <functional> // function
+
+// Runs a known amount of independent tasks on a pool of threads, each thread
+// takes the next unclaimed task until all are done
+class Executor {
+public:
+	// Zero threads uses the amount of hardware threads
+	explicit Executor(size_t threads = 0);
+
+	// Called once per task index, worker is the index of the thread in the pool
+	using Task = std::function<void(size_t index, size_t worker)>;
+
+	// Blocks until every task has run, the calling thread takes part as worker 0
+	void run(size_t count, const Task& task) const;
+
+	size_t threads() const { return m_threads; }
+
+private:
+	size_t m_threads { 1 };
+};
@@ -1,35 +1,172 @@
 /*
- * Copyright (C) 2022,2025 Riyyi
+ * Copyright (C) 2022,2025-2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
 
-#include <cstdint>    // int8_t
+#include <cstdint>    // int8_t, uint32_t
 #include <filesystem> // std::filesystem::path
+#include <mutex>      // call_once, lock_guard
 #include <pwd.h>      // getpwnam
 #include <sstream>    // istringstream
+#include <string>
+#include <string_view>
+#include <sys/stat.h> // stat
 #include <unistd.h>   // gethostname, getlogin
 
 #include "ruc/file.h"
 
+#include "cache.h"
 #include "machine.h"
+#include "processscanner.h"
 
 Machine::Machine(s)
 {
-	fetchDistro();
-	fetchHostname();
-	fetchUsername();
-	fetchSession();
 }
 
 Machine::~Machine()
 {
+	writeCache();
 }
 
 // -----------------------------------------
 
-void Machine::fetchDistro()
+const std::string& Machine::distroId() const
 {
+	std::call_once(m_distroFlag, &Machine::fetchDistro, this);
+	return m_distroId;
+}
+
+const std::string& Machine::distroIdLike() const
+{
+	std::call_once(m_distroFlag, &Machine::fetchDistro, this);
+	return m_distroIdLike;
+}
+
+const std::string& Machine::hostname() const
+{
+	std::call_once(m_hostnameFlag, &Machine::fetchHostname, this);
+	return m_hostname;
+}
+
+const std::string& Machine::username() const
+{
+	std::call_once(m_usernameFlag, &Machine::fetchUsername, this);
+	return m_username;
+}
+
+uint32_t Machine::uid() const
+{
+	std::call_once(m_usernameFlag, &Machine::fetchUsername, this);
+	return m_uid;
+}
+
+uint32_t Machine::gid() const
+{
+	std::call_once(m_usernameFlag, &Machine::fetchUsername, this);
+	return m_gid;
+}
+
+const std::string& Machine::session() const
+{
+	std::call_once(m_sessionFlag, &Machine::fetchSession, this);
+	return m_session;
+}
+
+// -----------------------------------------
+
+void Machine::loadCache() const
+{
+	if (!m_cache) {
+		return;
+	}
+
+	m_cacheFile = Cache::runtimeDirectory();
+	auto bootId = Cache::read("/proc/sys/kernel/random/boot_id");
+	struct stat status;
+	if (m_cacheFile.empty() || !bootId.has_value() || stat("/etc/os-release", &status) != 0) {
+		m_cache = false;
+		return;
+	}
+	m_cacheFile /= "machine";
+
+	// Format: <boot id>\n<os-release mtime>\n<fact>=<value>\n...
+	m_cacheKey = bootId.value();
+	m_cacheKey += std::to_string(status.st_mtim.tv_sec) + '.' + std::to_string(status.st_mtim.tv_nsec) + '\n';
+
+	auto data = Cache::read(m_cacheFile);
+	if (!data.has_value() || data->compare(0, m_cacheKey.size(), m_cacheKey) != 0) {
+		return;
+	}
+
+	std::istringstream stream(data->substr(m_cacheKey.size()));
+	for (std::string line; std::getline(stream, line);) {
+		size_t separator = line.find('=');
+		if (separator != std::string::npos) {
+			m_cachedFacts.emplace(line.substr(0, separator), line.substr(separator + 1));
+		}
+	}
+}
+
+bool Machine::cached(Facts facts) const
+{
+	std::call_once(m_cacheFlag, &Machine::loadCache, this);
+
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	if (!m_cache) {
+		return false;
+	}
+
+	for (const auto& [name, value] : facts) {
+		if (m_cachedFacts.find(name) == m_cachedFacts.end()) {
+			return false;
+		}
+	}
+	for (const auto& [name, value] : facts) {
+		*value = m_cachedFacts.at(name);
+	}
+
+	return true;
+}
+
+void Machine::storeCache(Facts facts) const
+{
+	std::call_once(m_cacheFlag, &Machine::loadCache, this);
+
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	if (!m_cache) {
+		return;
+	}
+
+	for (const auto& [name, value] : facts) {
+		m_cachedFacts[name] = *value;
+	}
+	m_cacheChanged = true;
+}
+
+void Machine::writeCache() const
+{
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	if (!m_cache || !m_cacheChanged) {
+		return;
+	}
+
+	std::string data = m_cacheKey;
+	for (const auto& [name, value] : m_cachedFacts) {
+		data += name + '=' + value + '\n';
+	}
+	Cache::write(m_cacheFile, data);
+	m_cacheChanged = false;
+}
+
+// -----------------------------------------
+
+void Machine::fetchDistro() const
+{
+	if (cached({ { "distroId", &m_distroId }, { "distroIdLike", &m_distroIdLike } })) {
+		return;
+	}
+
 	ruc::File osRelease("/etc/os-release");
 	std::istringstream stream(osRelease.data());
 	for (std::string line; std::getline(stream, line);) {
@@ -40,19 +177,35 @@ void Machine::fetchDistro()
 			m_distroIdLike = line.substr(8);
 		}
 	}
+
+	storeCache({ { "distroId", &m_distroId }, { "distroIdLike", &m_distroIdLike } });
 }
 
-void Machine::fetchHostname()
+void Machine::fetchHostname() const
 {
+	if (cached({ { "hostname", &m_hostname } })) {
+		return;
+	}
+
 	char hostname[64] { 0 };
 	if (gethostname(hostname, 64) < 0) {
 		perror("\033[31;1mError:\033[0m gethostname");
 	}
 	m_hostname = hostname;
+
+	storeCache({ { "hostname", &m_hostname } });
 }
 
-void Machine::fetchUsername()
+void Machine::fetchUsername() const
 {
+	std::string uid;
+	std::string gid;
+	if (cached({ { "username", &m_username }, { "uid", &uid }, { "gid", &gid } })) {
+		m_uid = std::stoul(uid);
+		m_gid = std::stoul(gid);
+		return;
+	}
+
 	// Get the username logged in on the controlling terminal of the process
 	char username[32] { 0 };
 	if (getlogin_r(username, 32) != 0) {
@@ -60,13 +213,21 @@ void Machine::fetchUsername()
 	}
 
 	// Get the password database record (/etc/passwd) of the user
-	m_passwd = getpwnam(username);
-	if (m_passwd == nullptr) {
+	passwd* record = getpwnam(username);
+	if (record == nullptr) {
 		perror("\033[31;1mError:\033[0m getpwnam");
+		return;
 	}
+	m_username = record->pw_name;
+	m_uid = record->pw_uid;
+	m_gid = record->pw_gid;
+
+	uid = std::to_string(m_uid);
+	gid = std::to_string(m_gid);
+	storeCache({ { "username", &m_username }, { "uid", &uid }, { "gid", &gid } });
 }
 
-void Machine::fetchSession()
+void Machine::fetchSession() const
 {
 	// Determine if this is an Xorg or Wayland session
 	int8_t likelyWayland = 0;
@@ -91,6 +252,13 @@ void Machine::fetchSession()
 		}
 	}
 
+	// The rest of the detection only depends on the machine, so the session
+	// is cached per outcome of the environment variables
+	std::string fact = "session." + std::to_string(likelyWayland);
+	if (cached({ { fact.c_str(), &m_session } })) {
+		return;
+	}
+
 	// Detect via Wayland socket
 	auto socket = std::filesystem::path("/run/user") / std::to_string(uid());
 	if (std::filesystem::exists(socket) && std::filesystem::is_directory(socket)) {
@@ -108,32 +276,21 @@ void Machine::fetchSession()
 	}
 
 	// Detect via running processes, /proc/<id>/comm
-	std::filesystem::path processes = "/proc";
-	if (std::filesystem::exists(processes) && std::filesystem::is_directory(processes)) {
-		for (const auto& entry : std::filesystem::directory_iterator(processes)) {
-			if (std::filesystem::is_directory(entry)) {
-
-				std::filesystem::path comm = entry.path() / "comm";
-				if (!std::filesystem::exists(comm)) {
-					continue;
-				}
-
-				// Read the contents of the "comm" file
-				std::ifstream stream(comm);
-				std::string command;
-				std::getline(stream, command);
-
-				if (command == "Xwayland" || command == "sway" || command == "hyprland") {
-					likelyWayland++;
-					break;
-				}
-
-				if (command == "Xorg" || command == "xinit" || command == "i3" || command == "bspwm") {
-					likelyWayland--;
-					break;
-				}
+	// Skipped when a single process cant change the outcome anymore
+	if (likelyWayland > -3 && likelyWayland < 3) {
+		ProcessScanner::scan("/proc", [&likelyWayland](std::string_view command) -> bool {
+			if (command == "Xwayland" || command == "sway" || command == "hyprland") {
+				likelyWayland++;
+				return false;
 			}
-		}
+
+			if (command == "Xorg" || command == "xinit" || command == "i3" || command == "bspwm") {
+				likelyWayland--;
+				return false;
+			}
+
+			return true;
+		});
 	}
 
 	// If we detected at least 2 ways, we can be fairly certain
@@ -144,4 +301,6 @@ void Machine::fetchSession()
 	else if (likelyWayland >= 2) {
 		m_session = "wayland";
 	}
+
+	storeCache({ { fact.c_str(), &m_session } });
 }
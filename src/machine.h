@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Riyyi
+ * Copyright (C) 2022,2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
@@ -7,35 +7,72 @@
 #pragma once
 
 #include <cstdint> // uint32_t
-#include <pwd.h>   // passwd
+#include <filesystem>
+#include <initializer_list>
+#include <map>
+#include <mutex> // call_once, mutex, once_flag
 #include <string>
+#include <utility> // pair
 
 #include "ruc/singleton.h"
 
+// Facts about the machine are fetched on first access and then remembered,
+// most runs only need a few of them
+// Fetched facts are also kept in $XDG_RUNTIME_DIR/manafiles/machine for the
+// next runs, until the machine reboots or /etc/os-release changes
+// The session also depends on the environment of the process, so it is kept
+// per value of the session variables
 class Machine : public ruc::Singleton<Machine> {
 public:
 	Machine(s);
 	virtual ~Machine();
 
-	const std::string& distroId() const { return m_distroId; }
-	const std::string& distroIdLike() const { return m_distroIdLike; }
-	const std::string& hostname() const { return m_hostname; }
+	const std::string& distroId() const;
+	const std::string& distroIdLike() const;
+	const std::string& hostname() const;
 
-	std::string username() const { return std::string(m_passwd->pw_name); }
-	uint32_t uid() const { return m_passwd->pw_uid; }
-	uint32_t gid() const { return m_passwd->pw_gid; }
+	const std::string& username() const;
+	uint32_t uid() const;
+	uint32_t gid() const;
 
-	const std::string& session() const { return m_session; }
+	const std::string& session() const;
+
+	// Set before the first fact is accessed
+	void setCache(bool cache) { m_cache = cache; }
+	// Write the facts fetched by this run to the cache, also done on destruction
+	void writeCache() const;
 
 private:
-	void fetchDistro();
-	void fetchHostname();
-	void fetchUsername();
-	void fetchSession();
-
-	std::string m_distroId;
-	std::string m_distroIdLike;
-	std::string m_hostname;
-	std::string m_session;
-	passwd* m_passwd { nullptr };
+	using Facts = std::initializer_list<std::pair<const char*, std::string*>>;
+
+	void loadCache() const;
+	bool cached(Facts facts) const;
+	void storeCache(Facts facts) const;
+
+	void fetchDistro() const;
+	void fetchHostname() const;
+	void fetchUsername() const;
+	void fetchSession() const;
+
+	mutable std::once_flag m_distroFlag;
+	mutable std::once_flag m_hostnameFlag;
+	mutable std::once_flag m_usernameFlag;
+	mutable std::once_flag m_sessionFlag;
+	mutable std::once_flag m_cacheFlag;
+
+	mutable std::string m_distroId;
+	mutable std::string m_distroIdLike;
+	mutable std::string m_hostname;
+	mutable std::string m_username;
+	mutable std::string m_session;
+	mutable uint32_t m_uid { 0 };
+	mutable uint32_t m_gid { 0 };
+
+	mutable bool m_cache { true };
+	mutable std::mutex m_cacheMutex;
+	mutable std::filesystem::path m_cacheFile;
+	// Boot ID and modification time of /etc/os-release the facts belong to
+	mutable std::string m_cacheKey;
+	mutable std::map<std::string, std::string> m_cachedFacts;
+	mutable bool m_cacheChanged { false };
 };
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2021-2022,2025 Riyyi
+ * Copyright (C) 2021-2022,2025-2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
@@ -13,6 +13,7 @@
 
 #include "config.h"
 #include "dotfile.h"
+#include "machine.h"
 #include "package.h"
 
 int main(int argc, const char* argv[])
@@ -23,6 +24,7 @@ int main(int argc, const char* argv[])
 
 	bool addOrAur = false;
 	bool install = false;
+	bool noCache = false;
 	bool pull = false;
 	bool pushOrSearch = false;
 	bool verbose = false;
@@ -37,6 +39,7 @@ int main(int argc, const char* argv[])
 	argParser.addOption(addOrAur, 'a', "add", nullptr, nullptr);
 	argParser.addOption(install, 'i', "install", nullptr, nullptr);
 	argParser.addOption(pull, 'l', "pull", nullptr, nullptr);
+	argParser.addOption(noCache, 'n', "no-cache", nullptr, nullptr);
 	argParser.addOption(pushOrSearch, 's', "push", nullptr, nullptr);
 	argParser.addOption(verbose, 'v', "verbose", nullptr, nullptr);
 
@@ -52,9 +55,13 @@ int main(int argc, const char* argv[])
 	ruc::Timer t;
 #endif
 
-	Config::the().setVerbose(verbose);
+	// Operations only set up the subsystems they use, the config is loaded
+	// for file operations, as finding it walks the working directory
+	Machine::the().setCache(!noCache);
 
 	if (fileOperation) {
+		Config::the().setVerbose(verbose);
+
 		if (addOrAur) {
 			Dotfile::the().add(targets);
 		}
@@ -69,6 +76,8 @@ int main(int argc, const char* argv[])
 		}
 	}
 	else if (packageOperation) {
+		Package::the().setCache(!noCache);
+
 		if (addOrAur) {
 			Package::the().aurInstall(targets);
 		}
@@ -86,6 +95,9 @@ int main(int argc, const char* argv[])
 		// TODO: open manpage
 	}
 
+	// Store the facts fetched by the operation for the next run, once
+	Machine::the().writeCache();
+
 #ifndef NDEBUG
 	printf("%fms\n", t.elapsedNanoseconds() / 1000000.0);
 #endif
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef> // size_t
+#include <fcntl.h> // O_CLOEXEC, O_RDONLY, open
+#include <filesystem>
+#include <sys/mman.h> // MAP_FAILED, madvise, mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "mappedfile.h"
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0) {
+		close(fd);
+		return;
+	}
+
+	// Mapping zero bytes fails, so empty files have no mapping
+	m_size = static_cast<size_t>(status.st_size);
+	if (m_size > 0) {
+		m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (m_data == MAP_FAILED) {
+			m_data = nullptr;
+			m_size = 0;
+			close(fd);
+			return;
+		}
+		madvise(m_data, m_size, MADV_SEQUENTIAL);
+	}
+
+	close(fd);
+	m_valid = true;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr) {
+		munmap(m_data, m_size);
+	}
+}
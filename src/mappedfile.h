@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <filesystem>
+#include <string_view>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False if the file couldnt be opened, an empty file is valid
+	bool valid() const { return m_valid; }
+	std::string_view data() const { return { static_cast<const char*>(m_data), m_size }; }
+
+private:
+	bool m_valid { false };
+	void* m_data { nullptr };
+	size_t m_size { 0 };
+};
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <bitset>
+#include <cstddef> // size_t
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "matcher.h"
+
+Matcher::Matcher(const std::vector<std::string>& patterns)
+{
+	for (const auto& text : patterns) {
+		if (text.empty()) {
+			continue;
+		}
+
+		// A dot matches everything in the current working directory
+		if (text == ".") {
+			m_matchAll = true;
+			continue;
+		}
+
+		Pattern pattern;
+		pattern.text = text;
+
+		// If starts with '/', only match in the working directory root
+		pattern.onlyMatchInRoot = text.front() == '/';
+
+		// If ends with '/', only match directories
+		pattern.onlyMatchDirectories = text.back() == '/';
+
+		// The trailing slash of a directory pattern can be matched by the end of the path
+		size_t requiredSize = text.size() - (pattern.onlyMatchDirectories ? 1 : 0);
+
+		size_t anchorIndex = pattern.onlyMatchInRoot ? 1 : 0;
+		if (anchorIndex < requiredSize && text.at(anchorIndex) != '*') {
+			pattern.anchor = text.at(anchorIndex);
+		}
+
+		for (size_t i = 0; i < requiredSize; ++i) {
+			if (text.at(i) != '*') {
+				pattern.required.set(static_cast<unsigned char>(text.at(i)));
+			}
+		}
+
+		m_patterns.push_back(pattern);
+	}
+}
+
+// -----------------------------------------
+
+bool Matcher::match(std::string_view path) const
+{
+	if (m_matchAll) {
+		return true;
+	}
+
+	// Collect all characters in the path, and the characters starting a path component
+	std::bitset<256> present;
+	std::bitset<256> componentStart;
+	for (size_t i = 0; i < path.size(); ++i) {
+		auto character = static_cast<unsigned char>(path[i]);
+		present.set(character);
+		if (i == 1 || (i > 0 && path[i - 1] == '/')) {
+			componentStart.set(character);
+		}
+	}
+
+	for (const auto& pattern : m_patterns) {
+		// Exact match is obviously true
+		if (path == pattern.text) {
+			return true;
+		}
+
+		// Patterns can only match if the path contains all of their literal characters
+		if (pattern.anchor != '\0' && !componentStart.test(static_cast<unsigned char>(pattern.anchor))) {
+			continue;
+		}
+		if ((pattern.required & ~present).any()) {
+			continue;
+		}
+
+		if (matchPattern(path, pattern)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Matcher::matchPattern(std::string_view path, const Pattern& pattern)
+{
+	const std::string& text = pattern.text;
+
+	bool tryPatternState = true;
+
+	size_t pathIterator = 0;
+	size_t patternIterator = 0;
+
+	if (!pattern.onlyMatchInRoot) {
+		pathIterator++;
+	}
+
+	// Current path charter 'x' == next ignore pattern characters '*x'
+	// Example, iterator at []: [.]log/output.txt
+	//                          [*].log
+	if (pathIterator < path.length()
+	    && patternIterator < text.length() - 1
+	    && text.at(patternIterator) == '*'
+	    && path.at(pathIterator) == text.at(patternIterator + 1)) {
+		patternIterator++;
+	}
+
+	for (; pathIterator < path.length() && patternIterator < text.length();) {
+		char character = path.at(pathIterator);
+		pathIterator++;
+
+		if (!tryPatternState && character == '/') {
+			tryPatternState = true;
+			continue;
+		}
+
+		if (!tryPatternState) {
+			continue;
+		}
+
+		if (character == text.at(patternIterator)) {
+			// Fail if the final match hasn't reached the end of the ignore pattern
+			// Example, iterator at []: doc/buil[d]
+			//                          buil[d]/
+			if (pathIterator == path.length() && patternIterator < text.length() - 1) {
+				break;
+			}
+
+			// Next path character 'x' == next ignore pattern characters '*x', skip the '*'
+			// Example, iterator at []: /includ[e]/header.h
+			//                          /includ[e]*/
+			if (pathIterator < path.length()
+			    && patternIterator + 2 < text.length()
+			    && text.at(patternIterator + 1) == '*'
+			    && path.at(pathIterator) == text.at(patternIterator + 2)) {
+				patternIterator++;
+			}
+
+			patternIterator++;
+			continue;
+		}
+
+		if (text.at(patternIterator) == '*') {
+			// Fail if we're entering a subdirectory and we should only match in the root
+			// Example, iterator at []: /src[/]include/header.h
+			//                          /[*]include/
+			if (pattern.onlyMatchInRoot && character == '/') {
+				break;
+			}
+
+			// Next path character == next ignore pattern character
+			if (pathIterator < path.length()
+			    && patternIterator + 1 < text.length()
+			    && path.at(pathIterator) == text.at(patternIterator + 1)) {
+				patternIterator++;
+			}
+
+			continue;
+		}
+
+		// Reset filter pattern if it hasnt been completed at this point
+		// Example, iterator at []: /[s]rc/include/header.h
+		//                          /[i]nclude*/
+		if (patternIterator < text.length() - 1) {
+			patternIterator = 0;
+		}
+
+		tryPatternState = false;
+	}
+
+	if (patternIterator == text.length()) {
+		return true;
+	}
+	if (text.back() == '*' && patternIterator == text.length() - 1) {
+		return true;
+	}
+	if (pattern.onlyMatchDirectories && patternIterator == text.length() - 1) {
+		return true;
+	}
+
+	return false;
+}
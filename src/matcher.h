@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Precompiled set of ignore/system patterns, see README.org for the syntax
+// One pass over the path rules out the patterns it cant match, only the
+// others are scanned
+class Matcher {
+public:
+	Matcher() {}
+	explicit Matcher(const std::vector<std::string>& patterns);
+
+	// Path relative to the working directory, starting with a slash
+	bool match(std::string_view path) const;
+
+	bool empty() const { return !m_matchAll && m_patterns.empty(); }
+
+private:
+	struct Pattern {
+		std::string text;
+		bool onlyMatchInRoot { false };
+		bool onlyMatchDirectories { false };
+		// First literal character, has to be the start of a path component
+		char anchor { '\0' };
+		// Literal characters that have to appear in the path
+		std::bitset<256> required {};
+	};
+
+	static bool matchPattern(std::string_view path, const Pattern& pattern);
+
+	bool m_matchAll { false };
+	std::vector<Pattern> m_patterns;
+};
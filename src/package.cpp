@@ -1,24 +1,31 @@
 /*
- * Copyright (C) 2021-2022,2025 Riyyi
+ * Copyright (C) 2021-2022,2025-2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
 
-#include <algorithm> // replace
 #include <array>
+#include <cstddef>    // size_t
 #include <cstdio>     // fprintf, printf, stderr
 #include <cstdlib>    // system
-#include <filesystem> // exists
+#include <filesystem> // exists, is_regular_file
 #include <optional>
-#include <sstream> // istringstream
-#include <string>  // getline
+#include <sstream>    // istringstream
+#include <string>     // getline, to_string
+#include <sys/stat.h> // stat
+#include <utility>    // move
 #include <vector>
 
-#include "ruc/shell.h"
+#include "ruc/file.h"
 #include "ruc/system.h"
 
+#include "cache.h"
+#include "dpkg.h"
 #include "machine.h"
 #include "package.h"
+#include "packageset.h"
+#include "pacman.h"
+#include "syncindex.h"
 
 Package::Package(s)
 {
@@ -120,31 +127,39 @@ void Package::installOrAurInstall(InstallType type, const std::string& file)
 		}
 	}
 
+	if (!std::filesystem::is_regular_file(file)) {
+		fprintf(stderr, "\033[31;1mPackage:\033[0m package list '%s' not found\n", file.c_str());
+		return;
+	}
+	auto packages = PackageSet::fromLines(ruc::File(file).data());
+
 	std::string command = "";
 
 	ruc::System $;
+	SyncIndex index;
 	if (m_distro == Distro::Arch) {
 		// Grab everything off enabled official repositories that is in the list
-		auto repoList = $("pacman -Ssq") | $("grep -xf " + file);
+		auto repoPackages = index.readPacman()
+		                        ? index.filter(packages)
+		                        : PackageSet::fromLines($("pacman -Ssq").output()).intersection(packages);
 
 		if (type == InstallType::AurInstall) {
 			// Determine which packages in the list are from the AUR
-			// NOTE: ruc::System does not support commands with newlines
-			auto aurList = ruc::Shell()("grep -vx '" + repoList.output() + "' " + file);
-			command = aurHelper.value() + " -Sy --devel --needed --noconfirm " + aurList.output();
+			auto aurPackages = packages.difference(repoPackages);
+			command = aurHelper.value() + " -Sy --devel --needed --noconfirm " + aurPackages.join(' ');
 		}
 		else {
-			command = "pacman -Sy --needed " + repoList.output();
+			command = "pacman -Sy --needed " + repoPackages.join(' ');
 		}
 	}
 	else if (m_distro == Distro::Debian) {
 		// Grab everything off enabled official repositories that is in the list
-		auto repoList = $("apt-cache search .").cut(1, ' ') | $("grep -xf " + file);
-		command = "apt install " + repoList.output();
+		auto repoPackages = index.readApt()
+		                        ? index.filter(packages)
+		                        : PackageSet::fromLines($("apt-cache search .").cut(1, ' ').output()).intersection(packages);
+		command = "apt install " + repoPackages.join(' ');
 	}
 
-	std::replace(command.begin(), command.end(), '\n', ' ');
-
 #ifndef NDEBUG
 	printf("running: $ %s\n", command.c_str());
 #endif
@@ -214,29 +229,122 @@ bool Package::distroDependencies()
 
 std::optional<std::string> Package::getPackageList()
 {
-	if (!distroDetect() || !distroDependencies()) {
+	if (!distroDetect()) {
 		return {};
 	}
 
+	// The list is cached with the state of the database it was built from,
+	// which is taken before building it, so changes made meanwhile are never hidden
+	std::string key = m_cache ? databaseKey() : "";
+	auto cacheFile = Cache::directory();
+	if (!key.empty() && !cacheFile.empty()) {
+		cacheFile /= "packages";
+		auto data = Cache::read(cacheFile);
+		if (data.has_value() && data->size() > key.size() && data->compare(0, key.size(), key) == 0 && data->at(key.size()) == '\n') {
+			return data->substr(key.size() + 1);
+		}
+	}
+
+	auto packages = fetchPackageList();
+	if (packages.has_value() && !key.empty() && !cacheFile.empty()) {
+		Cache::write(cacheFile, key + '\n' + packages.value());
+	}
+
+	return packages;
+}
+
+std::optional<std::string> Package::fetchPackageList()
+{
 	std::string packages;
 
+	// Read the package databases in-process, instead of starting the package manager tools
+	if (m_distro == Distro::Arch) {
+		Pacman pacman;
+		if (pacman.readLocal()) {
+			for (const auto& package : pacman.explicitPackages()) {
+				packages.append(package + '\n');
+			}
+			return packages;
+		}
+	}
+	else if (m_distro == Distro::Debian) {
+		std::vector<std::string> manualPackages;
+		if (Dpkg().manualPackages(manualPackages)) {
+			for (const auto& package : manualPackages) {
+				packages.append(package + '\n');
+			}
+			return packages;
+		}
+	}
+
+	if (!distroDependencies()) {
+		return {};
+	}
+
 	ruc::System $;
 	if (m_distro == Distro::Arch) {
-		auto basePackages = $("pactree -u base").tail(2, true);
-		auto develPackages = $("pacman -Qqg base-devel");
-		auto filterList = (basePackages + develPackages).sort(true);
-		auto packageList = ($("pacman -Qqe") | $("grep -xv " + filterList.output())).sort();
-		packages = packageList.output();
+		// pactree lists base itself on the first line
+		auto basePackages = PackageSet::fromLines($("pactree -u base").tail(2, true).output());
+		auto develPackages = PackageSet::fromLines($("pacman -Qqg base-devel").output());
+		auto explicitPackages = PackageSet::fromLines($("pacman -Qqe").output());
+		packages = explicitPackages.difference(basePackages.unite(develPackages)).join();
 	}
 	else if (m_distro == Distro::Debian) {
-		auto installedList = $("dpkg-query --show --showformat=${Package}\\t${Priority}\\n");
-		auto filterList = (installedList | $("grep -E required|important|standard")).cut(1);
-		installedList = installedList.cut(1);
-		auto installedManuallyList = $("awk '/Commandline:.* install / && !/APT::/ { print $NF }' /var/log/apt/history.log");
-		installedManuallyList = (installedManuallyList + $("apt-mark showmanual")).sort(true);
-		auto packageList = installedManuallyList | $("grep -x " + installedList.output()) | $("grep -xv " + filterList.output());
-		packages = packageList.output();
+		std::vector<std::string> installed;
+		std::vector<std::string> filter;
+		std::istringstream stream($("dpkg-query --show --showformat=${Package}\\t${Priority}\\n").output());
+		for (std::string line; std::getline(stream, line);) {
+			size_t tab = line.find('\t');
+			std::string priority = (tab != std::string::npos) ? line.substr(tab + 1) : "";
+			installed.push_back(line.substr(0, tab));
+			if (priority == "required" || priority == "important" || priority == "standard") {
+				filter.push_back(installed.back());
+			}
+		}
+
+		auto historyPackages = PackageSet::fromLines($("awk '/Commandline:.* install / && !/APT::/ { print $NF }' /var/log/apt/history.log").output());
+		auto manualPackages = historyPackages.unite(PackageSet::fromLines($("apt-mark showmanual").output()));
+		packages = manualPackages.intersection(PackageSet(std::move(installed))).difference(PackageSet(std::move(filter))).join();
 	}
 
 	return packages;
 }
+
+std::string Package::databaseKey()
+{
+	// Format version, followed by the state of every file the list is built from
+	std::string key = "packages 1 " + std::to_string(static_cast<int>(m_distro));
+
+	if (m_distro == Distro::Arch) {
+		// Installs and removals rename entries in local, other transactions
+		// rewrite desc files in place, but always take the lock in its parent
+		if (statKey("/var/lib/pacman", key) && statKey("/var/lib/pacman/local", key)) {
+			return key;
+		}
+	}
+	else if (m_distro == Distro::Debian) {
+		// The automatic marks and the history of apt are optional, these are keyed on being missing too
+		if (statKey("/var/lib/dpkg/status", key)) {
+			statKey("/var/lib/apt/extended_states", key);
+			statKey("/var/log/apt/history.log", key);
+			return key;
+		}
+	}
+
+	return {};
+}
+
+bool Package::statKey(const std::filesystem::path& path, std::string& key)
+{
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0) {
+		key.append(" -");
+		return false;
+	}
+
+	key.append(" " + std::to_string(status.st_dev) + ":" + std::to_string(status.st_ino)
+	           + ":" + std::to_string(status.st_size)
+	           + ":" + std::to_string(status.st_mtim.tv_sec) + "." + std::to_string(status.st_mtim.tv_nsec)
+	           + ":" + std::to_string(status.st_ctim.tv_sec) + "." + std::to_string(status.st_ctim.tv_nsec));
+	return true;
+}
@@ -1,12 +1,13 @@
 /*
- * Copyright (C) 2021-2022,2025 Riyyi
+ * Copyright (C) 2021-2022,2025-2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
 
 #pragma once
 
-#include <cstdint> // uint8_t
+#include <cstdint>    // uint8_t
+#include <filesystem> // path
 #include <optional>
 #include <string>
 #include <vector>
@@ -35,6 +36,8 @@ public:
 	void install(const std::vector<std::string>& targets = {});
 	void list(const std::vector<std::string>& targets = {}, bool partialMatch = false);
 
+	void setCache(bool cache) { m_cache = cache; }
+
 private:
 	std::optional<std::string> fetchAurHelper();
 	void installOrAurInstall(InstallType type, const std::string& file);
@@ -43,6 +46,12 @@ private:
 	bool distroDetect();
 	bool distroDependencies();
 	std::optional<std::string> getPackageList();
+	std::optional<std::string> fetchPackageList();
+
+	// Identifies the state of the package database, empty if unknown
+	std::string databaseKey();
+	static bool statKey(const std::filesystem::path& path, std::string& key);
 
 	Distro m_distro { Distro::Unsupported };
+	bool m_cache { true };
 };
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>  // binary_search, set_difference, set_intersection, set_union, sort, unique
+#include <cstddef>    // size_t
+#include <functional> // less
+#include <iterator>   // back_inserter
+#include <string>
+#include <string_view>
+#include <utility> // move
+#include <vector>
+
+#include "packageset.h"
+
+PackageSet::PackageSet(std::vector<std::string> names)
+	: m_names(std::move(names))
+{
+	std::sort(m_names.begin(), m_names.end());
+	m_names.erase(std::unique(m_names.begin(), m_names.end()), m_names.end());
+}
+
+// -----------------------------------------
+
+PackageSet PackageSet::fromLines(std::string_view lines)
+{
+	std::vector<std::string> names;
+	for (size_t lineStart = 0; lineStart < lines.size();) {
+		size_t lineEnd = lines.find('\n', lineStart);
+		if (lineEnd == std::string_view::npos) {
+			lineEnd = lines.size();
+		}
+
+		std::string_view line = lines.substr(lineStart, lineEnd - lineStart);
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start != std::string_view::npos) {
+			names.emplace_back(line.substr(start, line.find_last_not_of(" \t\r") + 1 - start));
+		}
+
+		lineStart = lineEnd + 1;
+	}
+
+	return PackageSet(std::move(names));
+}
+
+PackageSet PackageSet::intersection(const PackageSet& other) const
+{
+	PackageSet result;
+	std::set_intersection(m_names.begin(), m_names.end(), other.m_names.begin(), other.m_names.end(),
+	                      std::back_inserter(result.m_names));
+	return result;
+}
+
+PackageSet PackageSet::difference(const PackageSet& other) const
+{
+	PackageSet result;
+	std::set_difference(m_names.begin(), m_names.end(), other.m_names.begin(), other.m_names.end(),
+	                    std::back_inserter(result.m_names));
+	return result;
+}
+
+PackageSet PackageSet::unite(const PackageSet& other) const
+{
+	PackageSet result;
+	std::set_union(m_names.begin(), m_names.end(), other.m_names.begin(), other.m_names.end(),
+	               std::back_inserter(result.m_names));
+	return result;
+}
+
+bool PackageSet::contains(std::string_view name) const
+{
+	return std::binary_search(m_names.begin(), m_names.end(), name, std::less<> {});
+}
+
+std::string PackageSet::join(char separator) const
+{
+	size_t size = 0;
+	for (const auto& name : m_names) {
+		size += name.size() + 1;
+	}
+
+	std::string result;
+	result.reserve(size);
+	for (const auto& name : m_names) {
+		result.append(name);
+		result.push_back(separator);
+	}
+
+	return result;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sorted set of unique package names, the set operations merge the sorted
+// names in linear time
+class PackageSet {
+public:
+	PackageSet() = default;
+	explicit PackageSet(std::vector<std::string> names);
+
+	// One name per line, surrounding whitespace and empty lines are ignored
+	static PackageSet fromLines(std::string_view lines);
+
+	PackageSet intersection(const PackageSet& other) const;
+	PackageSet difference(const PackageSet& other) const;
+	PackageSet unite(const PackageSet& other) const;
+
+	bool contains(std::string_view name) const;
+
+	// Names separated by the separator, with a trailing one
+	std::string join(char separator = '\n') const;
+
+	const std::vector<std::string>& names() const { return m_names; }
+	size_t size() const { return m_names.size(); }
+	bool empty() const { return m_names.empty(); }
+
+private:
+	std::vector<std::string> m_names;
+};
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm> // find
+#include <cstddef>   // size_t
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error> // error_code
+#include <unordered_set>
+#include <utility> // move
+#include <vector>
+
+#include "mappedfile.h"
+#include "packageset.h"
+#include "pacman.h"
+
+Pacman::Pacman(const std::filesystem::path& database)
+	: m_database(database)
+{
+}
+
+// -----------------------------------------
+
+bool Pacman::readLocal()
+{
+	m_packages.clear();
+	m_names.clear();
+	m_provides.clear();
+
+	// An entry that cant be read, like one that pacman is still writing,
+	// makes the whole database unreliable
+	bool unreadable = false;
+
+	std::error_code error;
+	auto iterator = std::filesystem::directory_iterator(m_database / "local", error);
+	for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+		// Skip the ALPM_DB_VERSION file
+		std::error_code statusError;
+		if (!it->is_directory(statusError)) {
+			continue;
+		}
+
+		MappedFile desc(it->path() / "desc");
+		LocalPackage package;
+		parseDesc(desc.data(), package);
+		if (!desc.valid() || package.name.empty()) {
+			unreadable = true;
+			continue;
+		}
+
+		m_names.emplace(package.name, m_packages.size());
+		for (const auto& provide : package.provides) {
+			m_provides.emplace(provide, m_packages.size());
+		}
+		m_packages.push_back(std::move(package));
+	}
+
+	return !error && !unreadable && !m_packages.empty();
+}
+
+std::vector<std::string> Pacman::explicitPackages() const
+{
+	std::vector<std::string> packages;
+	for (const auto& package : m_packages) {
+		if (package.explicitly) {
+			packages.push_back(package.name);
+		}
+	}
+
+	auto filter = PackageSet(dependencyClosure("base")).unite(PackageSet(groupMembers("base-devel")));
+	return PackageSet(std::move(packages)).difference(filter).names();
+}
+
+std::vector<std::string> Pacman::dependencyClosure(const std::string& name) const
+{
+	std::vector<std::string> closure;
+
+	const LocalPackage* root = resolve(name);
+	if (root == nullptr) {
+		return closure;
+	}
+
+	// Breadth-first, the package itself is not part of its closure
+	std::unordered_set<const LocalPackage*> visited { root };
+	std::vector<const LocalPackage*> queue { root };
+	for (size_t i = 0; i < queue.size(); ++i) {
+		for (const auto& depend : queue.at(i)->depends) {
+			const LocalPackage* dependency = resolve(depend);
+			if (dependency == nullptr || !visited.insert(dependency).second) {
+				continue;
+			}
+			closure.push_back(dependency->name);
+			queue.push_back(dependency);
+		}
+	}
+
+	return closure;
+}
+
+std::vector<std::string> Pacman::groupMembers(const std::string& group) const
+{
+	std::vector<std::string> members;
+	for (const auto& package : m_packages) {
+		if (std::find(package.groups.begin(), package.groups.end(), group) != package.groups.end()) {
+			members.push_back(package.name);
+		}
+	}
+
+	return members;
+}
+
+void Pacman::parseDesc(std::string_view desc, LocalPackage& package)
+{
+	// Format: %SECTION%\n<value>\n<value>\n\n%SECTION%\n...
+	std::string_view section;
+	while (!desc.empty()) {
+		size_t lineEnd = desc.find('\n');
+		std::string_view line = desc.substr(0, lineEnd);
+		desc = (lineEnd != std::string_view::npos) ? desc.substr(lineEnd + 1) : std::string_view {};
+
+		if (line.empty()) {
+			section = {};
+			continue;
+		}
+		if (section.empty() && line.size() > 2 && line.front() == '%' && line.back() == '%') {
+			section = line;
+			continue;
+		}
+
+		// Dependencies can have a version constraint, e.g. glibc>=2.35
+		auto name = [&line]() -> std::string {
+			return std::string(line.substr(0, line.find_first_of("<>=:")));
+		};
+
+		if (section == "%NAME%") {
+			package.name = line;
+		}
+		else if (section == "%REASON%") {
+			package.explicitly = line == "0";
+		}
+		else if (section == "%GROUPS%") {
+			package.groups.emplace_back(line);
+		}
+		else if (section == "%DEPENDS%") {
+			package.depends.push_back(name());
+		}
+		else if (section == "%PROVIDES%") {
+			package.provides.push_back(name());
+		}
+	}
+}
+
+// -----------------------------------------
+
+const Pacman::LocalPackage* Pacman::resolve(const std::string& name) const
+{
+	auto it = m_names.find(name);
+	if (it != m_names.end()) {
+		return &m_packages.at(it->second);
+	}
+
+	it = m_provides.find(name);
+	if (it != m_provides.end()) {
+		return &m_packages.at(it->second);
+	}
+
+	return nullptr;
+}
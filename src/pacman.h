@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Reads the pacman database directly, instead of starting pacman and pactree
+class Pacman {
+public:
+	explicit Pacman(const std::filesystem::path& database = "/var/lib/pacman");
+
+	struct LocalPackage {
+		std::string name;
+		// Installed on request, instead of as a dependency
+		bool explicitly { true };
+		std::vector<std::string> groups;
+		// Names only, without the version constraints
+		std::vector<std::string> depends;
+		std::vector<std::string> provides;
+	};
+
+	// Parse every <database>/local/<package>/desc, returns false if it or any
+	// of the entries couldnt be read
+	bool readLocal();
+
+	// Explicitly installed packages that are not part of the base install,
+	// this is everything base depends on and the base-devel group, sorted
+	std::vector<std::string> explicitPackages() const;
+
+	// Installed packages that the package depends on, recursively, like pactree -u
+	std::vector<std::string> dependencyClosure(const std::string& name) const;
+	// Installed packages in the group, like pacman -Qqg
+	std::vector<std::string> groupMembers(const std::string& group) const;
+
+	const std::vector<LocalPackage>& packages() const { return m_packages; }
+
+private:
+	static void parseDesc(std::string_view desc, LocalPackage& package);
+
+	// Installed package that has the name or provides it
+	const LocalPackage* resolve(const std::string& name) const;
+
+	std::filesystem::path m_database;
+	std::vector<LocalPackage> m_packages;
+	std::unordered_map<std::string, size_t> m_names;
+	std::unordered_map<std::string, size_t> m_provides;
+};
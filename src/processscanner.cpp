@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef>  // size_t
+#include <dirent.h> // DT_DIR, DT_UNKNOWN, dirent64, getdents64
+#include <fcntl.h>  // O_CLOEXEC, O_DIRECTORY, O_RDONLY, open, openat
+#include <string>
+#include <string_view>
+#include <sys/types.h> // ssize_t
+#include <unistd.h>    // close, pread
+
+#include "processscanner.h"
+
+bool ProcessScanner::scan(const std::string& root, const Callback& callback)
+{
+	int directory = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (directory < 0) {
+		return false;
+	}
+
+	alignas(struct dirent64) char buffer[32 * 1024];
+	for (;;) {
+		ssize_t size = getdents64(directory, buffer, sizeof(buffer));
+		if (size <= 0) {
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < size;) {
+			const auto* entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+			offset += entry->d_reclen;
+
+			// Processes are the directories with a numeric name
+			if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
+				continue;
+			}
+			size_t length = 0;
+			while (entry->d_name[length] >= '0' && entry->d_name[length] <= '9') {
+				length++;
+			}
+			if (length == 0 || entry->d_name[length] != '\0') {
+				continue;
+			}
+
+			// <pid>/comm, relative to the directory
+			char path[sizeof(entry->d_name) + 5];
+			std::char_traits<char>::copy(path, entry->d_name, length);
+			std::char_traits<char>::copy(path + length, "/comm", 6);
+
+			// The process can exit while scanning
+			int comm = openat(directory, path, O_RDONLY | O_CLOEXEC);
+			if (comm < 0) {
+				continue;
+			}
+
+			// The kernel truncates command names to 15 characters
+			char command[64];
+			ssize_t read = pread(comm, command, sizeof(command), 0);
+			close(comm);
+			if (read <= 0) {
+				continue;
+			}
+			if (command[read - 1] == '\n') {
+				read--;
+			}
+
+			if (!callback(std::string_view(command, read))) {
+				close(directory);
+				return true;
+			}
+		}
+	}
+
+	close(directory);
+	return true;
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <functional> // function
+#include <string>
+#include <string_view>
+
+// Reads the command names of the running processes from /proc/<pid>/comm,
+// without allocating per process
+class ProcessScanner {
+public:
+	// Return false to stop scanning
+	using Callback = std::function<bool(std::string_view command)>;
+
+	// Call the callback for every process in the /proc-like directory,
+	// returns false if the directory couldnt be read
+	static bool scan(const std::string& root, const Callback& callback);
+};
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <cstddef>   // size_t
+#include <cstring>   // memcmp, strnlen
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error> // error_code
+#include <unordered_set>
+#include <utility> // move
+#include <vector>
+#include <zlib.h> // gzbuffer, gzclose, gzopen, gzread, gzseek
+
+#include "executor.h"
+#include "mappedfile.h"
+#include "packageset.h"
+#include "syncindex.h"
+
+SyncIndex::SyncIndex(size_t threads)
+	: m_threads(threads)
+{
+}
+
+// -----------------------------------------
+
+bool SyncIndex::readPacman(const std::filesystem::path& database)
+{
+	std::vector<std::filesystem::path> files;
+
+	std::error_code error;
+	auto iterator = std::filesystem::directory_iterator(database / "sync", error);
+	for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+		if (it->path().extension() == ".db") {
+			files.push_back(it->path());
+		}
+	}
+
+	return !error && read(files, &SyncIndex::readPacmanDatabase);
+}
+
+bool SyncIndex::readApt(const std::filesystem::path& lists)
+{
+	std::vector<std::filesystem::path> files;
+
+	std::error_code error;
+	auto iterator = std::filesystem::directory_iterator(lists, error);
+	for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+		auto name = it->path().filename().string();
+		if (name.ends_with("_Packages") || name.ends_with("_Packages.gz")) {
+			files.push_back(it->path());
+		}
+	}
+
+	return !error && read(files, &SyncIndex::readAptPackages);
+}
+
+PackageSet SyncIndex::filter(const PackageSet& packages) const
+{
+	std::vector<std::string> names;
+	for (const auto& name : packages.names()) {
+		if (contains(name)) {
+			names.push_back(name);
+		}
+	}
+
+	return PackageSet(std::move(names));
+}
+
+bool SyncIndex::readPacmanDatabase(const std::filesystem::path& path, std::vector<std::string>& names)
+{
+	// zlib reads plain files as they are, other compressions are not supported
+	gzFile file = gzopen(path.c_str(), "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	gzbuffer(file, 128 * 1024);
+
+	auto readFully = [&file](char* buffer, size_t size) -> bool {
+		return gzread(file, buffer, size) == static_cast<int>(size);
+	};
+
+	// Tar archive of <name>-<version>-<release>/desc entries, in 512 byte blocks
+	bool valid = true;
+	std::string longName;
+	char header[512];
+	while (readFully(header, sizeof(header))) {
+		// The archive ends with empty blocks
+		if (header[0] == '\0') {
+			break;
+		}
+
+		// ustar magic, anything else is a different or corrupt format
+		if (memcmp(header + 257, "ustar", 5) != 0) {
+			valid = false;
+			break;
+		}
+
+		size_t size = 0;
+		for (size_t i = 124; i < 136 && header[i] >= '0' && header[i] <= '7'; ++i) {
+			size = size * 8 + (header[i] - '0');
+		}
+		size_t padded = (size + 511) & ~static_cast<size_t>(511);
+
+		std::string name;
+		if (!longName.empty()) {
+			name = std::move(longName);
+			longName.clear();
+		}
+		else {
+			std::string_view prefix(header + 345, strnlen(header + 345, 155));
+			name = prefix.empty() ? "" : std::string(prefix) + '/';
+			name.append(header, strnlen(header, 100));
+		}
+
+		char type = header[156];
+
+		// Names longer than the header holds, GNU and pax style
+		if (type == 'L' || type == 'x') {
+			std::string data(padded, '\0');
+			if (!readFully(data.data(), padded)) {
+				valid = false;
+				break;
+			}
+			data.resize(size);
+
+			if (type == 'L') {
+				longName = data.substr(0, data.find('\0'));
+			}
+			else {
+				// Records: "<length> path=<name>\n"
+				size_t path = data.find(" path=");
+				if (path != std::string::npos) {
+					size_t end = data.find('\n', path);
+					longName = data.substr(path + 6, end - path - 6);
+				}
+			}
+			continue;
+		}
+
+		// Skip over the contents of the entry
+		if (padded > 0 && gzseek(file, padded, SEEK_CUR) < 0) {
+			valid = false;
+			break;
+		}
+
+		// Every package has a desc file, named after the package directory
+		if (!name.ends_with("/desc")) {
+			continue;
+		}
+		std::string_view directory(name.data(), name.size() - 5);
+		size_t release = directory.rfind('-');
+		size_t version = (release != std::string_view::npos && release > 0) ? directory.rfind('-', release - 1) : std::string_view::npos;
+		if (version != std::string_view::npos && version > 0) {
+			names.emplace_back(directory.substr(0, version));
+		}
+	}
+
+	gzclose(file);
+	return valid;
+}
+
+bool SyncIndex::readAptPackages(const std::filesystem::path& path, std::vector<std::string>& names)
+{
+	// Collect the "Package: <name>" lines
+	auto scan = [&names](std::string_view data) -> void {
+		constexpr std::string_view field = "Package: ";
+		for (size_t position = 0; position < data.size();) {
+			size_t lineEnd = data.find('\n', position);
+			if (lineEnd == std::string_view::npos) {
+				lineEnd = data.size();
+			}
+			if (data.compare(position, field.size(), field) == 0) {
+				names.emplace_back(data.substr(position + field.size(), lineEnd - position - field.size()));
+			}
+			position = lineEnd + 1;
+		}
+	};
+
+	if (path.extension() != ".gz") {
+		MappedFile file(path);
+		if (!file.valid()) {
+			return false;
+		}
+		scan(file.data());
+		return true;
+	}
+
+	gzFile file = gzopen(path.c_str(), "rb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	// Decompress in chunks, lines that cross a chunk are carried over
+	std::string data;
+	char buffer[128 * 1024];
+	int read = 0;
+	while ((read = gzread(file, buffer, sizeof(buffer))) > 0) {
+		data.append(buffer, read);
+		size_t lastLine = data.rfind('\n');
+		if (lastLine == std::string::npos) {
+			continue;
+		}
+		scan(std::string_view(data).substr(0, lastLine + 1));
+		data.erase(0, lastLine + 1);
+	}
+	scan(data);
+
+	gzclose(file);
+	return read == 0;
+}
+
+// -----------------------------------------
+
+bool SyncIndex::read(const std::vector<std::filesystem::path>& files,
+                     bool (*reader)(const std::filesystem::path&, std::vector<std::string>&))
+{
+	if (files.empty()) {
+		return false;
+	}
+
+	// Each repository is read by a single thread, into its own list
+	std::vector<std::vector<std::string>> names(files.size());
+	std::atomic<bool> valid { true };
+	Executor(m_threads).run(files.size(), [&](size_t index, size_t) {
+		if (!reader(files.at(index), names.at(index))) {
+			valid = false;
+		}
+	});
+
+	size_t total = 0;
+	for (const auto& repository : names) {
+		total += repository.size();
+	}
+	m_names.reserve(m_names.size() + total);
+	for (auto& repository : names) {
+		for (auto& name : repository) {
+			m_names.insert(std::move(name));
+		}
+	}
+
+	return valid;
+}
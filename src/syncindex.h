@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "packageset.h"
+
+// Names of all the packages in the enabled repositories, read from the
+// package manager databases, instead of starting pacman -Ssq or apt-cache
+class SyncIndex {
+public:
+	// Zero threads uses the amount of hardware threads
+	explicit SyncIndex(size_t threads = 0);
+
+	// Read every <database>/sync/*.db, gzip compressed or plain tar archives
+	// Returns false if there are none or one couldnt be read
+	bool readPacman(const std::filesystem::path& database = "/var/lib/pacman");
+	// Read every <lists>/*_Packages, plain or gzip compressed
+	// Returns false if there are none or one couldnt be read
+	bool readApt(const std::filesystem::path& lists = "/var/lib/apt/lists");
+
+	bool contains(const std::string& name) const { return m_names.find(name) != m_names.end(); }
+	size_t size() const { return m_names.size(); }
+
+	// The packages that are in the index
+	PackageSet filter(const PackageSet& packages) const;
+
+	static bool readPacmanDatabase(const std::filesystem::path& path, std::vector<std::string>& names);
+	static bool readAptPackages(const std::filesystem::path& path, std::vector<std::string>& names);
+
+private:
+	// Read the files in parallel, then merge the names into the index
+	bool read(const std::vector<std::filesystem::path>& files,
+	          bool (*reader)(const std::filesystem::path&, std::vector<std::string>&));
+
+	size_t m_threads { 0 };
+	std::unordered_set<std::string> m_names;
+};
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm> // max, min
+#include <cerrno>    // errno
+#include <cstddef>   // size_t
+#include <cstdint>   // uint32_t, uint64_t
+#include <cstring>   // memset
+#include <fcntl.h>   // AT_FDCWD, AT_SYMLINK_NOFOLLOW
+#include <linux/io_uring.h>
+#include <string>
+#include <sys/mman.h>      // mmap, munmap
+#include <sys/stat.h>      // lstat, statx
+#include <sys/syscall.h>   // SYS_io_uring_enter, SYS_io_uring_setup
+#include <sys/sysmacros.h> // makedev
+#include <unistd.h>        // close, syscall
+#include <utility>         // move
+#include <vector>
+
+#include "uring.h"
+
+Uring::Uring(uint32_t entries)
+{
+	if (!setup(entries)) {
+		teardown();
+	}
+}
+
+Uring::~Uring()
+{
+	teardown();
+}
+
+// -----------------------------------------
+
+void Uring::lstat(const std::vector<std::string>& paths, std::vector<struct stat>& statuses, std::vector<int>& errors)
+{
+	statuses.assign(paths.size(), {});
+	errors.assign(paths.size(), 0);
+	std::vector<bool> statted(paths.size(), false);
+
+	size_t done = 0;
+	while (available() && done < paths.size()) {
+		size_t end = std::min(done + m_sqEntries, paths.size());
+		if (!statxBatch(paths, done, end, statuses, errors, statted)) {
+			teardown();
+		}
+		done = end;
+	}
+
+	// Synchronous fallback, for the paths the ring didnt get to
+	for (size_t i = 0; i < paths.size(); ++i) {
+		if (!statted.at(i) && ::lstat(paths.at(i).c_str(), &statuses.at(i)) != 0) {
+			errors.at(i) = errno;
+		}
+	}
+}
+
+// -----------------------------------------
+
+bool Uring::setup(uint32_t entries)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	m_fd = syscall(SYS_io_uring_setup, entries, &params);
+	if (m_fd < 0) {
+		return false;
+	}
+
+	m_sqEntries = params.sq_entries;
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	// Since Linux 5.4 both rings share a single mapping
+	bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (singleMap) {
+		m_sqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+		m_cqRingSize = m_sqRingSize;
+	}
+
+	m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+	if (m_sqRing == MAP_FAILED) {
+		m_sqRing = nullptr;
+		return false;
+	}
+
+	if (singleMap) {
+		m_cqRing = m_sqRing;
+	}
+	else {
+		m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+		if (m_cqRing == MAP_FAILED) {
+			m_cqRing = nullptr;
+			return false;
+		}
+	}
+
+	m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		return false;
+	}
+	m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+	auto* sqRing = static_cast<char*>(m_sqRing);
+	m_sqHead = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.head);
+	m_sqTail = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.tail);
+	m_sqMask = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.ring_mask);
+	m_sqArray = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.array);
+
+	auto* cqRing = static_cast<char*>(m_cqRing);
+	m_cqHead = reinterpret_cast<uint32_t*>(cqRing + params.cq_off.head);
+	m_cqTail = reinterpret_cast<uint32_t*>(cqRing + params.cq_off.tail);
+	m_cqMask = reinterpret_cast<uint32_t*>(cqRing + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+
+	return true;
+}
+
+void Uring::teardown()
+{
+	if (m_sqes != nullptr) {
+		munmap(m_sqes, m_sqesSize);
+	}
+	if (m_cqRing != nullptr && m_cqRing != m_sqRing) {
+		munmap(m_cqRing, m_cqRingSize);
+	}
+	if (m_sqRing != nullptr) {
+		munmap(m_sqRing, m_sqRingSize);
+	}
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+
+	m_fd = -1;
+	m_sqRing = nullptr;
+	m_cqRing = nullptr;
+	m_sqes = nullptr;
+}
+
+bool Uring::statxBatch(const std::vector<std::string>& paths, size_t begin, size_t end,
+                       std::vector<struct stat>& statuses, std::vector<int>& errors, std::vector<bool>& statted)
+{
+	size_t count = end - begin;
+	std::vector<struct statx> buffers(count);
+
+	// Fill the submission queue, only this thread writes the tail
+	uint32_t tail = *m_sqTail;
+	for (size_t i = begin; i < end; ++i) {
+		uint32_t index = tail & *m_sqMask;
+		io_uring_sqe* sqe = &m_sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_STATX;
+		sqe->fd = AT_FDCWD;
+		sqe->addr = reinterpret_cast<uint64_t>(paths.at(i).c_str());
+		sqe->len = STATX_BASIC_STATS;
+		sqe->off = reinterpret_cast<uint64_t>(&buffers.at(i - begin));
+		sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+		sqe->user_data = i;
+		m_sqArray[index] = index;
+		tail++;
+	}
+	__atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+	bool supported = true;
+	size_t submitted = 0;
+	size_t completed = 0;
+	while (completed < count) {
+		long result = syscall(SYS_io_uring_enter, m_fd, count - submitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if (result < 0 && errno != EINTR && errno != EAGAIN) {
+			// Requests that are in flight still write to the buffers after the
+			// ring is closed, so these are never freed
+			if (submitted > completed) {
+				static std::vector<std::vector<struct statx>> abandoned;
+				abandoned.push_back(std::move(buffers));
+			}
+			return false;
+		}
+		if (result > 0) {
+			submitted += result;
+		}
+
+		uint32_t head = *m_cqHead;
+		uint32_t cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+		for (; head != cqTail; ++head, ++completed) {
+			const io_uring_cqe* cqe = &m_cqes[head & *m_cqMask];
+			size_t i = cqe->user_data;
+			if (cqe->res == -EINVAL) {
+				// Kernels before 5.6 dont know statx, these paths are stat'ed the regular way
+				supported = false;
+				continue;
+			}
+			statted.at(i) = true;
+			if (cqe->res < 0) {
+				errors.at(i) = -cqe->res;
+				continue;
+			}
+
+			const struct statx& x = buffers.at(i - begin);
+			struct stat& status = statuses.at(i);
+			status.st_dev = makedev(x.stx_dev_major, x.stx_dev_minor);
+			status.st_ino = x.stx_ino;
+			status.st_mode = x.stx_mode;
+			status.st_nlink = x.stx_nlink;
+			status.st_uid = x.stx_uid;
+			status.st_gid = x.stx_gid;
+			status.st_rdev = makedev(x.stx_rdev_major, x.stx_rdev_minor);
+			status.st_size = x.stx_size;
+			status.st_blksize = x.stx_blksize;
+			status.st_blocks = x.stx_blocks;
+			status.st_atim = { x.stx_atime.tv_sec, x.stx_atime.tv_nsec };
+			status.st_mtim = { x.stx_mtime.tv_sec, x.stx_mtime.tv_nsec };
+			status.st_ctim = { x.stx_ctime.tv_sec, x.stx_ctime.tv_nsec };
+		}
+		__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+	}
+
+	return supported;
+}
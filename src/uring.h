@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <string>
+#include <sys/stat.h> // stat
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Minimal io_uring ring, used to submit many filesystem requests per syscall
+// Falls back to plain syscalls when the kernel doesnt support io_uring
+class Uring {
+public:
+	explicit Uring(uint32_t entries = 256);
+	~Uring();
+
+	bool available() const { return m_fd >= 0; }
+
+	// Stat every path without following symlinks, errors holds 0 or the errno per path
+	void lstat(const std::vector<std::string>& paths, std::vector<struct stat>& statuses, std::vector<int>& errors);
+
+private:
+	bool setup(uint32_t entries);
+	void teardown();
+	// Returns false when the ring cant be used further, the paths that didnt
+	// complete are left unmarked in statted
+	bool statxBatch(const std::vector<std::string>& paths, size_t begin, size_t end,
+	                std::vector<struct stat>& statuses, std::vector<int>& errors, std::vector<bool>& statted);
+
+	int m_fd { -1 };
+
+	// Submission queue
+	void* m_sqRing { nullptr };
+	size_t m_sqRingSize { 0 };
+	uint32_t* m_sqHead { nullptr };
+	uint32_t* m_sqTail { nullptr };
+	uint32_t* m_sqMask { nullptr };
+	uint32_t* m_sqArray { nullptr };
+	uint32_t m_sqEntries { 0 };
+	io_uring_sqe* m_sqes { nullptr };
+	size_t m_sqesSize { 0 };
+
+	// Completion queue
+	void* m_cqRing { nullptr };
+	size_t m_cqRingSize { 0 };
+	uint32_t* m_cqHead { nullptr };
+	uint32_t* m_cqTail { nullptr };
+	uint32_t* m_cqMask { nullptr };
+	io_uring_cqe* m_cqes { nullptr };
+};
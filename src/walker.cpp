@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm> // sort
+#include <atomic>
+#include <cctype> // tolower
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <cstdio>  // fprintf, stderr
+#include <deque>
+#include <filesystem>
+#include <mutex> // lock_guard, mutex, unique_lock
+#include <optional>
+#include <system_error> // error_code
+#include <thread>
+#include <vector>
+
+#include "walker.h"
+
+Walker::Walker(size_t threads)
+	: m_threads(threads != 0 ? threads : std::thread::hardware_concurrency())
+{
+	if (m_threads == 0) {
+		m_threads = 1;
+	}
+}
+
+// -----------------------------------------
+
+std::vector<std::filesystem::directory_entry> Walker::walk(const std::filesystem::path& directory,
+                                                           const DescendCallback& descend) const
+{
+	return walk(std::vector<std::filesystem::path> { directory }, descend);
+}
+
+std::vector<std::filesystem::directory_entry> Walker::walk(const std::vector<std::filesystem::path>& directories,
+                                                           const DescendCallback& descend) const
+{
+	if (directories.empty()) {
+		return {};
+	}
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::filesystem::path> directories;
+	};
+
+	std::vector<Queue> queues(m_threads);
+	std::vector<std::vector<std::filesystem::path>> subdirectories(m_threads);
+	std::vector<std::vector<std::filesystem::directory_entry>> results(m_threads);
+	std::mutex errorMutex;
+
+	// Directories that are queued or being listed, and only the queued ones
+	std::atomic<size_t> pending { directories.size() };
+	std::atomic<size_t> queued { directories.size() };
+	for (size_t i = 0; i < directories.size(); ++i) {
+		queues.at(i % m_threads).directories.push_back(directories.at(i));
+	}
+
+	// Idle threads sleep until there is a directory to steal or the walk is done,
+	// so a slow directory listing doesnt keep the other cores busy
+	std::mutex idleMutex;
+	std::condition_variable idle;
+	std::atomic<size_t> sleeping { 0 };
+	auto wake = [&](bool all) -> void {
+		if (sleeping.load() == 0) {
+			return;
+		}
+		// Sleepers check the counters while holding the mutex, so taking it
+		// here makes sure they are waiting before they are notified
+		{
+			std::lock_guard<std::mutex> lock(idleMutex);
+		}
+		all ? idle.notify_all() : idle.notify_one();
+	};
+
+	// Take from the back of our own queue, steal from the front of the others
+	auto take = [&queues, &queued](size_t self) -> std::optional<std::filesystem::path> {
+		for (size_t i = 0; i < queues.size(); ++i) {
+			auto& queue = queues.at((self + i) % queues.size());
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.directories.empty()) {
+				continue;
+			}
+
+			std::filesystem::path path;
+			if (i == 0) {
+				path = std::move(queue.directories.back());
+				queue.directories.pop_back();
+			}
+			else {
+				path = std::move(queue.directories.front());
+				queue.directories.pop_front();
+			}
+			queued--;
+			return path;
+		}
+
+		return {};
+	};
+
+	auto printError = [&errorMutex](const std::filesystem::path& path, const std::error_code& error) -> void {
+		std::lock_guard<std::mutex> lock(errorMutex);
+		fprintf(stderr, "\033[31;1mWalker:\033[0m '%s': %c%s\n",
+		        path.c_str(),
+		        tolower(error.message().c_str()[0]),
+		        error.message().c_str() + 1);
+	};
+
+	auto work = [&](size_t self) -> void {
+		for (;;) {
+			auto path = take(self);
+			if (!path.has_value()) {
+				std::unique_lock<std::mutex> lock(idleMutex);
+				sleeping++;
+				idle.wait(lock, [&]() { return pending.load() == 0 || queued.load() > 0; });
+				sleeping--;
+				if (pending.load() == 0) {
+					return;
+				}
+				continue;
+			}
+
+			auto& found = subdirectories.at(self);
+			std::error_code error;
+			auto iterator = std::filesystem::directory_iterator(path.value(), error);
+			for (auto it = std::filesystem::begin(iterator); !error && it != std::filesystem::end(iterator); it.increment(error)) {
+				const auto& entry = *it;
+
+				std::error_code statusError;
+				if (!entry.is_directory(statusError)) {
+					results.at(self).push_back(entry);
+					continue;
+				}
+
+				// Symlinks to directories are not followed
+				if (entry.is_symlink(statusError) || (descend && !descend(entry))) {
+					continue;
+				}
+
+				found.push_back(entry.path());
+			}
+			if (error) {
+				printError(path.value(), error);
+			}
+
+			// Queue the subdirectories at once, then wake as many threads as there is work for
+			if (!found.empty()) {
+				pending += found.size();
+				queued += found.size();
+				{
+					auto& queue = queues.at(self);
+					std::lock_guard<std::mutex> lock(queue.mutex);
+					for (auto& subdirectory : found) {
+						queue.directories.push_back(std::move(subdirectory));
+					}
+				}
+				wake(found.size() > 1);
+				found.clear();
+			}
+
+			if (--pending == 0) {
+				wake(true);
+				return;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < m_threads; ++i) {
+		threads.emplace_back(work, i);
+	}
+	work(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	// Merge the results of all threads into a stable order
+	std::vector<std::filesystem::directory_entry> entries;
+	for (auto& result : results) {
+		entries.insert(entries.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+	}
+	std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.path() < rhs.path();
+	});
+
+	return entries;
+}
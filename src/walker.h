@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <filesystem>
+#include <functional> // function
+#include <string>
+#include <vector>
+
+// Entries of a directory tree collected by a single walk
+struct Snapshot {
+	// Sorted by path, excluding directories
+	std::vector<std::filesystem::directory_entry> entries;
+	// Relative to the walked directory, with a trailing slash
+	std::vector<std::string> prunedDirectories;
+	// Found, but not listed yet, the walk continues from these
+	std::vector<std::filesystem::path> unvisitedDirectories;
+};
+
+// Multi-threaded directory walker, idle threads steal directories from the
+// queues of busy threads
+class Walker {
+public:
+	// Zero threads uses the amount of hardware threads
+	explicit Walker(size_t threads = 0);
+
+	// Return false to skip the directory and everything below it
+	using DescendCallback = std::function<bool(const std::filesystem::directory_entry&)>;
+
+	// Collect every non-directory entry below the directory, sorted by path
+	std::vector<std::filesystem::directory_entry> walk(const std::filesystem::path& directory,
+	                                                   const DescendCallback& descend = nullptr) const;
+	// Same, below each of the directories
+	std::vector<std::filesystem::directory_entry> walk(const std::vector<std::filesystem::path>& directories,
+	                                                   const DescendCallback& descend = nullptr) const;
+
+	size_t threads() const { return m_threads; }
+
+private:
+	size_t m_threads { 1 };
+};
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <filesystem> // path
+#include <string>
+#include <sys/xattr.h>  // getxattr, setxattr
+#include <system_error> // error_code
+
+#include "ruc/file.h"
+
+#include "copier.h"
+#include "macro.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path copierDirectory = std::filesystem::current_path() / "__copier";
+
+// -----------------------------------------
+
+TEST_CASE(CopierCopiesFileContentsAndPermissions)
+{
+	std::filesystem::create_directories(copierDirectory);
+	auto from = copierDirectory / "__from";
+	auto to = copierDirectory / "__to";
+
+	std::string contents(300 * 1024, 'x');
+	contents.append("end\n");
+	ruc::File::create(from.string());
+	ruc::File(from.string()).append(contents).flush();
+	std::filesystem::permissions(from, std::filesystem::perms::owner_read | std::filesystem::perms::owner_exec);
+
+	// Overwrite an existing file, which has other contents and permissions
+	ruc::File::create(to.string());
+	ruc::File(to.string()).append("previous contents that are longer than nothing\n").flush();
+
+	Copier copier;
+	std::error_code error;
+	EXPECT(copier.copy(from, to, error));
+	EXPECT(!error);
+	EXPECT(copier.lastMethod() != Copier::Method::None);
+	EXPECT_EQ(ruc::File(to.string()).data(), contents);
+	EXPECT(std::filesystem::status(to).permissions() == std::filesystem::status(from).permissions());
+
+	// Empty files
+	ruc::File::create((copierDirectory / "__empty").string());
+	EXPECT(copier.copy(copierDirectory / "__empty", copierDirectory / "__empty-copy", error));
+	EXPECT_EQ(std::filesystem::file_size(copierDirectory / "__empty-copy"), 0);
+
+	// Missing source
+	EXPECT(!copier.copy(copierDirectory / "__missing", to, error));
+	EXPECT(error);
+
+	std::filesystem::remove_all(copierDirectory);
+}
+
+TEST_CASE(CopierWritesContents)
+{
+	std::filesystem::create_directories(copierDirectory);
+	auto to = copierDirectory / "__to";
+
+	ruc::File::create(to.string());
+	ruc::File(to.string()).append("previous contents that are longer\n").flush();
+
+	Copier copier;
+	std::error_code error;
+	EXPECT(copier.write(to, "contents\n", 0750, error));
+	EXPECT(copier.lastMethod() == Copier::Method::Write);
+	EXPECT_EQ(ruc::File(to.string()).data(), "contents\n");
+	EXPECT(std::filesystem::status(to).permissions() == static_cast<std::filesystem::perms>(0750));
+
+	std::filesystem::remove_all(copierDirectory);
+}
+
+TEST_CASE(CopierReplacesDestinationAtomically)
+{
+	std::filesystem::create_directories(copierDirectory);
+	auto from = copierDirectory / "__from";
+	auto to = copierDirectory / "__to";
+
+	ruc::File::create(from.string());
+	ruc::File(from.string()).append("new contents\n").flush();
+	ruc::File::create(to.string());
+	ruc::File(to.string()).append("old contents\n").flush();
+
+	// A hardlink still points to the old file, which was never truncated
+	std::filesystem::create_hard_link(to, copierDirectory / "__old");
+
+	Copier copier;
+	std::error_code error;
+	EXPECT(copier.copy(from, to, error));
+	EXPECT_EQ(ruc::File(to.string()).data(), "new contents\n");
+	EXPECT_EQ(ruc::File((copierDirectory / "__old").string()).data(), "old contents\n");
+	EXPECT_EQ(copier.filesystems().size(), 1, return);
+
+	// No temporary files are left behind
+	size_t count = 0;
+	for (const auto& entry : std::filesystem::directory_iterator(copierDirectory)) {
+		EXPECT(entry.path().filename().string().find(".manafiles-") == std::string::npos);
+		count++;
+	}
+	EXPECT_EQ(count, 3);
+
+	EXPECT(Copier::syncFilesystem(copier.filesystems().begin()->second, error));
+
+	std::filesystem::remove_all(copierDirectory);
+}
+
+TEST_CASE(CopierCopiesSymlinksAndDirectories)
+{
+	std::filesystem::create_directories(copierDirectory / "__directory" / "__subdirectory");
+	ruc::File::create((copierDirectory / "__directory" / "__subdirectory" / "__file").string());
+	ruc::File((copierDirectory / "__directory" / "__subdirectory" / "__file").string()).append("file\n").flush();
+
+	// Symlinks are copied as symlinks, also when the destination exists
+	auto link = copierDirectory / "__link";
+	std::filesystem::create_symlink("__directory/__subdirectory/__file", link);
+	ruc::File::create((copierDirectory / "__link-copy").string());
+
+	Copier copier;
+	std::error_code error;
+	EXPECT(copier.copy(link, copierDirectory / "__link-copy", error));
+	EXPECT(copier.lastMethod() == Copier::Method::Symlink);
+	EXPECT(std::filesystem::is_symlink(copierDirectory / "__link-copy"));
+	EXPECT_EQ(std::filesystem::read_symlink(copierDirectory / "__link-copy").string(), "__directory/__subdirectory/__file");
+
+	// Directories are copied recursively
+	EXPECT(copier.copy(copierDirectory / "__directory", copierDirectory / "__directory-copy", error));
+	EXPECT(copier.lastMethod() == Copier::Method::Directory);
+	EXPECT_EQ(ruc::File((copierDirectory / "__directory-copy" / "__subdirectory" / "__file").string()).data(), "file\n");
+
+	std::filesystem::remove_all(copierDirectory);
+}
+
+TEST_CASE(CopierDefersRenames)
+{
+	std::filesystem::create_directories(copierDirectory);
+	auto from = copierDirectory / "__from";
+	auto to = copierDirectory / "__to";
+
+	ruc::File::create(from.string());
+	ruc::File(from.string()).append("new contents\n").flush();
+	ruc::File::create(to.string());
+	ruc::File(to.string()).append("old contents\n").flush();
+
+	// The destination keeps its old contents until the caller renames the copy
+	Copier copier(true);
+	std::error_code error;
+	EXPECT(copier.copy(from, to, error));
+	EXPECT_EQ(ruc::File(to.string()).data(), "old contents\n");
+
+	auto pending = copier.takePending();
+	EXPECT_EQ(pending.size(), 1, return);
+	EXPECT(copier.takePending().empty());
+	EXPECT(std::filesystem::exists(pending.front().temporary));
+
+	EXPECT(Copier::syncFilesystem(copierDirectory, error));
+	EXPECT(Copier::rename(pending.front(), error));
+	EXPECT(Copier::syncDirectory(copierDirectory, error));
+	EXPECT_EQ(ruc::File(to.string()).data(), "new contents\n");
+	EXPECT(!std::filesystem::exists(pending.front().temporary));
+
+	std::filesystem::remove_all(copierDirectory);
+}
+
+TEST_CASE(CopierWritesThroughSymlinkedDestination)
+{
+	std::filesystem::create_directories(copierDirectory);
+	auto from = copierDirectory / "__from";
+	auto target = copierDirectory / "__target";
+	auto to = copierDirectory / "__to";
+
+	ruc::File::create(from.string());
+	ruc::File(from.string()).append("new contents\n").flush();
+	ruc::File::create(target.string());
+	ruc::File(target.string()).append("old contents\n").flush();
+	std::filesystem::create_symlink("__target", to);
+
+	// Extended attributes of the replaced file are kept, if the filesystem supports them
+	bool attributes = setxattr(target.c_str(), "user.manafiles", "value", 5, 0) == 0;
+
+	Copier copier;
+	std::error_code error;
+	EXPECT(copier.copy(from, to, error));
+	EXPECT(std::filesystem::is_symlink(to));
+	EXPECT_EQ(ruc::File(target.string()).data(), "new contents\n");
+	if (attributes) {
+		char value[16] {};
+		EXPECT_EQ(getxattr(target.c_str(), "user.manafiles", value, sizeof(value)), 5);
+		EXPECT_EQ(std::string(value), "value");
+	}
+
+	// A symlink to the source itself is replaced instead
+	std::filesystem::remove(to);
+	std::filesystem::create_symlink("__from", to);
+	EXPECT(copier.copy(from, to, error));
+	EXPECT(!std::filesystem::is_symlink(to));
+	EXPECT_EQ(ruc::File(to.string()).data(), "new contents\n");
+
+	std::filesystem::remove_all(copierDirectory);
+}
@@ -1,19 +1,31 @@
 /*
- * Copyright (C) 2022,2025 Riyyi
+ * Copyright (C) 2022,2025-2026 Riyyi
  *
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>  // min
+#include <csignal>    // kill, raise, SIGKILL, SIGSTOP, SIGTRAP
 #include <cstddef>    // size_t
-#include <cstdio>     // stderr
+#include <cstdio>     // printf, stderr, stdout
+#include <cstdlib>    // getenv, setenv, unsetenv
+#include <fcntl.h>    // AT_FDCWD
 #include <filesystem> // path
+#include <functional> // function
+#include <optional>
 #include <string>
-#include <unistd.h> // geteuid, setegid, seteuid
+#include <sys/fsuid.h>  // setfsgid, setfsuid
+#include <sys/ptrace.h> // ptrace
+#include <sys/stat.h>   // stat, utimensat
+#include <sys/wait.h>   // waitpid
+#include <unistd.h>     // _exit, fork, getegid, geteuid, setegid, seteuid
 #include <unordered_map>
 #include <vector>
 
 #include "ruc/file.h"
+#include "ruc/timer.h"
 
+#include "cache.h"
 #include "config.h"
 #include "dotfile.h"
 #include "machine.h"
@@ -100,6 +112,42 @@ void testDotfileFilters(const std::unordered_map<std::string, bool>& tests,
 	removeTestDotfiles(fileNames, false);
 }
 
+// Count the syscalls of an operation in a traced child process
+size_t countSyscalls(const std::function<void()>& operation)
+{
+	pid_t child = fork();
+	if (child == 0) {
+		stdout = test::TestSuite::the().outputNull();
+		ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+		raise(SIGSTOP);
+		operation();
+		_exit(0);
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	ptrace(PTRACE_SETOPTIONS, child, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+
+	// Every syscall stops the child twice, on entry and on exit
+	size_t stops = 0;
+	while (ptrace(PTRACE_SYSCALL, child, nullptr, nullptr) == 0 && waitpid(child, &status, 0) == child) {
+		if (WIFEXITED(status) || WIFSIGNALED(status)) {
+			break;
+		}
+		if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+			stops++;
+		}
+	}
+
+	// Tracing is not permitted
+	if (!WIFEXITED(status) && !WIFSIGNALED(status)) {
+		kill(child, SIGKILL);
+		waitpid(child, &status, 0);
+	}
+
+	return stops / 2;
+}
+
 // -----------------------------------------
 
 TEST_CASE(DotfilesLiteralIgnoreAllFiles)
@@ -499,6 +547,59 @@ TEST_CASE(PushDotfilesWithIgnorePattern)
 	removeTestDotfiles(fileNames);
 }
 
+TEST_CASE(ListDotfilesWithIgnoredDirectoryBenchmark)
+{
+	// The walk should only pay for the files that are not ignored
+	auto walk = [](size_t ignoredFileCount, size_t& syscalls) -> double {
+		std::vector<std::string> fileNames = {
+			"__walk/__test-file-1",
+			"__walk/__subdir/__test-file-2",
+		};
+		for (size_t i = 0; i < ignoredFileCount; ++i) {
+			fileNames.push_back("__walk/__ignored/__dir-" + std::to_string(i % 100) + "/__test-file-" + std::to_string(i));
+		}
+		createTestDotfiles(fileNames, std::vector<std::string>(fileNames.size(), ""));
+
+		auto ignorePatterns = Config::the().ignorePatterns();
+		Config::the().setIgnorePatterns({ "__ignored/" });
+
+		auto list = []() -> void {
+			Dotfile::the().list({ "__walk" });
+		};
+
+		double fastest = 0;
+		stdout = test::TestSuite::the().outputNull();
+		for (size_t i = 0; i < 5; ++i) {
+			ruc::Timer timer;
+			list();
+			double elapsed = timer.elapsedNanoseconds() / 1000000.0;
+			fastest = (i == 0) ? elapsed : std::min(fastest, elapsed);
+		}
+		stdout = test::TestSuite::the().outputStd();
+
+		// Single threaded, as the tracer only follows the main thread
+		Config::the().setThreads(1);
+		syscalls = countSyscalls(list);
+		Config::the().setThreads(0);
+
+		Config::the().setIgnorePatterns(ignorePatterns);
+		removeTestDotfiles(fileNames, false);
+
+		return fastest;
+	};
+
+	size_t smallSyscalls = 0;
+	size_t largeSyscalls = 0;
+	double small = walk(10, smallSyscalls);
+	double large = walk(4000, largeSyscalls);
+	printf("        10 ignored files: %fms, %zu syscalls, 4000 ignored files: %fms, %zu syscalls\n",
+	       small, smallSyscalls, large, largeSyscalls);
+
+	// The 100 ignored directories are never opened, listing them would take several syscalls each
+	EXPECT(smallSyscalls > 0);
+	EXPECT(largeSyscalls < smallSyscalls + 20);
+}
+
 TEST_CASE(PushDotfilesSelectivelyComment)
 {
 	std::vector<std::string> fileNames;
@@ -936,6 +1037,444 @@ test data <!----> uncomment
 	removeTestDotfiles(fileNames);
 }
 
+TEST_CASE(PushDotfilesSelectivelyCommentLargeFile)
+{
+	// Blocks are found anywhere in the file, also when the marker is split
+	// over two reads of the scan
+	std::string padding = "# padding\n";
+	std::string contents;
+	while (contents.size() < 64 * 1024 - 3) {
+		contents.append(padding);
+	}
+	contents.resize(64 * 1024 - 3, '#');
+	contents.append("\n# >>> distro=@@@@\ntest data\n# <<<\n");
+
+	std::string pushedContents = contents;
+	pushedContents.replace(pushedContents.find("test data"), 9, "# test data");
+
+	// Files without blocks are copied as-is
+	std::string plainContents(300 * 1024, 'x');
+
+	std::vector<std::string> fileNames = { "__test-file-1", "__test-file-2" };
+	createTestDotfiles(fileNames, { contents, plainContents });
+
+	Dotfile::the().push(fileNames);
+
+	EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), pushedContents);
+	EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(1)).string()).data(), plainContents);
+
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesSelectivelyCommentBenchmark)
+{
+	// Rewriting the blocks should scale linearly with the size of the file, the timings are only printed
+	auto push = [](size_t blockCount) -> double {
+		std::string contents;
+		std::string pushedContents;
+		for (size_t i = 0; i < blockCount; ++i) {
+			contents.append("# >>> distro=@@@@\n");
+			pushedContents.append("# >>> distro=@@@@\n");
+			for (size_t j = 0; j < 20; ++j) {
+				std::string line = "export VARIABLE_" + std::to_string(j) + "=\"value that is long enough\"\n";
+				contents.append(line);
+				pushedContents.append("# " + line);
+			}
+			contents.append("# <<<\n");
+			pushedContents.append("# <<<\n");
+		}
+
+		std::vector<std::string> fileNames = { "__test-file-1" };
+		createTestDotfiles(fileNames, { contents });
+
+		stdout = test::TestSuite::the().outputNull();
+		ruc::Timer timer;
+		Dotfile::the().push(fileNames);
+		double elapsed = timer.elapsedNanoseconds() / 1000000.0;
+		stdout = test::TestSuite::the().outputStd();
+
+		EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), pushedContents);
+
+		removeTestDotfiles(fileNames);
+
+		return elapsed;
+	};
+
+	double small = push(1000);
+	double large = push(4000);
+	printf("        1000 blocks (1MB): %fms, 4000 blocks (4MB): %fms\n", small, large);
+}
+
+TEST_CASE(PushDotfilesSkipUnchanged)
+{
+	std::vector<std::string> fileNames = {
+		"__test-file-1",
+		"__test-file-2",
+	};
+
+	std::vector<std::string> fileContents = {
+		R"(plain file
+)",
+		"# >>> distro=@@@@" + std::string(R"(
+templated file
+# <<<
+)"),
+	};
+
+	createTestDotfiles(fileNames, fileContents);
+
+	Dotfile::the().push(fileNames);
+
+	// Plain copies keep the modification time of the source
+	struct stat source;
+	struct stat destination;
+	EXPECT(stat(fileNames.at(0).c_str(), &source) == 0);
+	EXPECT(stat((homeDirectory / fileNames.at(0)).c_str(), &destination) == 0);
+	EXPECT_EQ(source.st_mtim.tv_sec, destination.st_mtim.tv_sec);
+	EXPECT_EQ(source.st_mtim.tv_nsec, destination.st_mtim.tv_nsec);
+
+	// Destinations that already hold the right contents are not written to
+	const struct timespec times[2] = { { 0, UTIME_OMIT }, { 1000, 0 } };
+	for (const auto& file : fileNames) {
+		utimensat(AT_FDCWD, (homeDirectory / file).c_str(), times, 0);
+	}
+
+	Dotfile::the().push(fileNames);
+
+	for (const auto& file : fileNames) {
+		EXPECT(stat((homeDirectory / file).c_str(), &destination) == 0);
+		EXPECT_EQ(destination.st_mtim.tv_sec, 1000);
+	}
+
+	// Changed sources are copied again
+	ruc::File file(fileNames.at(0));
+	file.append("more\n").flush();
+
+	Dotfile::the().push(fileNames);
+
+	EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), "plain file\nmore\n");
+
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesRenderAfterFactChange)
+{
+	// Facts are faked through the cache of the machine facts
+	const char* env = std::getenv("XDG_RUNTIME_DIR");
+	std::optional<std::string> previous;
+	if (env != nullptr) {
+		previous = env;
+	}
+	auto runtimeDirectory = std::filesystem::current_path() / "__runtime";
+	std::filesystem::create_directories(runtimeDirectory);
+	setenv("XDG_RUNTIME_DIR", runtimeDirectory.c_str(), 1);
+
+	std::vector<std::string> fileNames = { "__test-file-1" };
+	createTestDotfiles(fileNames, { "# >>> hostname=__other-host\n# foo\n# <<<\n" });
+
+	// The block doesnt match this machine, so rendering leaves the file as-is
+	Machine::destroy();
+	Dotfile::the().push(fileNames);
+	EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), "# >>> hostname=__other-host\n# foo\n# <<<\n");
+	Machine::destroy();
+
+	auto cacheFile = runtimeDirectory / "manafiles" / "machine";
+	auto cache = Cache::read(cacheFile);
+	EXPECT(cache.has_value());
+	if (cache.has_value()) {
+		size_t position = cache->find("hostname=");
+		EXPECT(position != std::string::npos);
+		if (position != std::string::npos) {
+			cache->replace(position, cache->find('\n', position) - position, "hostname=__other-host");
+			EXPECT(Cache::write(cacheFile, cache.value()));
+		}
+
+		// Now it matches, so the next push renders it again
+		Dotfile::the().push(fileNames);
+		EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), "# >>> hostname=__other-host\nfoo\n# <<<\n");
+	}
+
+	Machine::destroy();
+	if (previous.has_value()) {
+		setenv("XDG_RUNTIME_DIR", previous->c_str(), 1);
+	}
+	else {
+		unsetenv("XDG_RUNTIME_DIR");
+	}
+	std::filesystem::remove_all(runtimeDirectory);
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesWithoutChangesNotRewritten)
+{
+	std::vector<std::string> fileNames = {
+		"__test-file-1",
+		"__test-file-2",
+	};
+
+	std::vector<std::string> fileContents = {
+		// No markers
+		std::string(64 * 1024, 'x') + "\n>> # <<<\n",
+		// Markers, but nothing to comment or uncomment
+		"# >>> distro=" + Machine::the().distroId() + R"(
+matching file
+# <<<
+)",
+	};
+
+	createTestDotfiles(fileNames, fileContents);
+
+	Dotfile::the().push(fileNames);
+
+	// Destinations that were not rendered keep the modification time of the
+	// source, the others never have it
+	struct stat modified[2];
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		struct stat source;
+		EXPECT(stat(fileNames.at(i).c_str(), &source) == 0, continue);
+		EXPECT(stat((homeDirectory / fileNames.at(i)).c_str(), &modified[i]) == 0, continue);
+		bool same = source.st_mtim.tv_sec == modified[i].st_mtim.tv_sec && source.st_mtim.tv_nsec == modified[i].st_mtim.tv_nsec;
+		EXPECT_EQ(same, i == 0);
+		EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(i)).string()).data(), fileContents.at(i));
+	}
+
+	// The next push compares the rendered file, and doesnt rewrite it
+	Dotfile::the().push(fileNames);
+	struct stat destination;
+	EXPECT(stat((homeDirectory / fileNames.at(1)).c_str(), &destination) == 0);
+	EXPECT_EQ(destination.st_ino, modified[1].st_ino);
+
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesSyscallBenchmark)
+{
+	auto push = []() -> void {
+		Dotfile::the().push({ "__test-dir" });
+	};
+
+	std::vector<std::string> fileNames;
+	for (size_t i = 0; i < 100; ++i) {
+		fileNames.push_back("__test-dir/__subdir-" + std::to_string(i % 5) + "/__nested/__test-file-" + std::to_string(i));
+	}
+	createTestDotfiles(fileNames, std::vector<std::string>(fileNames.size(), "file\n"));
+
+	// Single threaded, as the tracer only follows the main thread
+	Config::the().setThreads(1);
+	size_t copy = countSyscalls(push);
+	size_t skip = countSyscalls(push);
+	Config::the().setThreads(0);
+	printf("        100 files copied: %zu syscalls, 100 files skipped: %zu syscalls\n", copy, skip);
+
+	EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), "file\n");
+	EXPECT(copy < fileNames.size() * 12);
+	EXPECT(skip < fileNames.size() * 2);
+
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesParallel)
+{
+	std::vector<std::string> fileNames;
+	std::vector<std::string> fileContents;
+	for (size_t i = 0; i < 100; ++i) {
+		fileNames.push_back("__test-dir/__subdir-" + std::to_string(i % 10) + "/__test-file-" + std::to_string(i));
+		fileContents.push_back("file " + std::to_string(i) + "\n");
+	}
+
+	createTestDotfiles(fileNames, fileContents);
+
+	Config::the().setThreads(4);
+	Dotfile::the().push({ "__test-dir" });
+	Config::the().setThreads(0);
+
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		auto file = homeDirectory / fileNames.at(i);
+		EXPECT_EQ(ruc::File(file.string()).data(), fileContents.at(i), continue);
+
+		// Home files are owned by the user, also when copied by root
+		struct stat status;
+		EXPECT(stat(file.c_str(), &status) == 0, continue);
+		EXPECT_EQ(status.st_uid, Machine::the().uid());
+		EXPECT_EQ(status.st_gid, Machine::the().gid());
+	}
+
+	struct stat status;
+	EXPECT(stat((homeDirectory / "__test-dir/__subdir-0").c_str(), &status) == 0);
+	EXPECT_EQ(status.st_uid, Machine::the().uid());
+
+	// The calling thread gets its filesystem credentials back
+	EXPECT_EQ(setfsuid(-1), static_cast<int>(geteuid()));
+	EXPECT_EQ(setfsgid(-1), static_cast<int>(getegid()));
+
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesRenameAsUser)
+{
+	EXPECT(root, return);
+
+	// In a sticky directory only the owner of a file can replace it, so the
+	// copies of root owned files can be made but not renamed by the user
+	// Enough files that the other threads also take part in the renames
+	std::vector<std::string> fileNames;
+	std::vector<std::string> fileContents;
+	for (size_t i = 0; i < 200; ++i) {
+		fileNames.push_back("__test-sticky/__test-file-" + std::to_string(i));
+		fileContents.push_back("new " + std::to_string(i) + "\n");
+	}
+	createTestDotfiles(fileNames, fileContents);
+
+	auto sticky = homeDirectory / "__test-sticky";
+	std::filesystem::create_directories(sticky);
+	std::filesystem::permissions(sticky, static_cast<std::filesystem::perms>(01777));
+	for (const auto& fileName : fileNames) {
+		ruc::File::create((homeDirectory / fileName).string());
+		ruc::File((homeDirectory / fileName).string()).append("old\n").flush();
+	}
+
+	// The copies that cant be renamed are reported
+	auto previous = stderr;
+	stderr = test::TestSuite::the().outputNull();
+	Config::the().setThreads(4);
+	Dotfile::the().push({ "__test-sticky" });
+	Config::the().setThreads(0);
+	stderr = previous;
+
+	// Every thread renamed with the credentials of the user
+	for (const auto& fileName : fileNames) {
+		EXPECT_EQ(ruc::File((homeDirectory / fileName).string()).data(), "old\n");
+	}
+
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesRemoveStaleCopies)
+{
+	const char* env = std::getenv("XDG_CACHE_HOME");
+	std::optional<std::string> previous;
+	if (env != nullptr) {
+		previous = env;
+	}
+	auto cacheDirectory = std::filesystem::current_path() / "__cache";
+	std::filesystem::create_directories(cacheDirectory);
+	setenv("XDG_CACHE_HOME", cacheDirectory.c_str(), 1);
+
+	std::vector<std::string> fileNames = { "__test-file-1" };
+	createTestDotfiles(fileNames, { "file\n" });
+
+	// The pid of a process that has exited
+	pid_t exited = fork();
+	if (exited == 0) {
+		_exit(0);
+	}
+	waitpid(exited, nullptr, 0);
+
+	// Copies of a run that was killed before its renames, and of one that is still running
+	auto stale = homeDirectory / (".__test-file-1.manafiles-" + std::to_string(exited) + "-0");
+	auto running = homeDirectory / ".__test-file-1.manafiles-1-0";
+	ruc::File::create(stale.string());
+	ruc::File::create(running.string());
+	auto journal = Cache::directory() / "deploying";
+	EXPECT(Cache::write(journal, homeDirectory.string() + "\n"));
+
+	Dotfile::the().push(fileNames);
+
+	EXPECT(!std::filesystem::exists(stale));
+	EXPECT(std::filesystem::exists(running));
+	EXPECT(!std::filesystem::exists(journal));
+	EXPECT_EQ(ruc::File((homeDirectory / fileNames.at(0)).string()).data(), "file\n");
+
+	if (previous.has_value()) {
+		setenv("XDG_CACHE_HOME", previous->c_str(), 1);
+	}
+	else {
+		unsetenv("XDG_CACHE_HOME");
+	}
+	std::filesystem::remove_all(cacheDirectory);
+	std::filesystem::remove(running);
+	removeTestDotfiles(fileNames);
+}
+
+TEST_CASE(PushDotfilesDeployLinks)
+{
+	std::vector<std::string> fileNames = {
+		"__test-file-1",
+		"__test-dir/__test-file-2",
+	};
+
+	std::vector<std::string> fileContents = {
+		"plain file\n",
+		"# >>> distro=" + Machine::the().distroId() + R"(
+# templated file
+# <<<
+)",
+	};
+
+	createTestDotfiles(fileNames, fileContents);
+
+	auto linked = homeDirectory / fileNames.at(0);
+	auto templated = homeDirectory / fileNames.at(1);
+	auto source = std::filesystem::current_path() / fileNames.at(0);
+
+	// Files without blocks become symlinks into the working directory
+	Config::the().setDeploy(Config::Deploy::Symlink);
+	Dotfile::the().push(fileNames);
+	EXPECT(std::filesystem::is_symlink(linked));
+	EXPECT_EQ(std::filesystem::read_symlink(linked).string(), source.string());
+	EXPECT(!std::filesystem::is_symlink(templated));
+	EXPECT_EQ(ruc::File(templated.string()).data(), "# >>> distro=" + Machine::the().distroId() + R"(
+templated file
+# <<<
+)");
+
+	// Pulling doesnt replace the source with the symlink that points at it
+	Dotfile::the().pull({ fileNames.at(0) });
+	EXPECT(!std::filesystem::is_symlink(fileNames.at(0)));
+	EXPECT_EQ(ruc::File(fileNames.at(0)).data(), fileContents.at(0));
+
+	// A source that gets a block is copied on the next push
+	std::string block = "# >>> distro=" + Machine::the().distroId() + "\n# block\n# <<<\n";
+	ruc::File(fileNames.at(0)).append(block).flush();
+	const struct timespec times[2] = { { 0, UTIME_OMIT }, { 1, 0 } };
+	utimensat(AT_FDCWD, fileNames.at(0).c_str(), times, 0);
+	Dotfile::the().push(fileNames);
+	EXPECT(!std::filesystem::is_symlink(linked));
+	EXPECT_EQ(ruc::File(linked.string()).data(), "plain file\n# >>> distro=" + Machine::the().distroId() + "\nblock\n# <<<\n");
+
+	removeTestDotfiles(fileNames);
+	createTestDotfiles(fileNames, fileContents);
+
+	// Hardlinks share the file with the working directory, when on the same filesystem
+	Config::the().setDeploy(Config::Deploy::Hardlink);
+	Dotfile::the().push(fileNames);
+	Config::the().setDeploy(Config::Deploy::Copy);
+
+	struct stat sourceStatus;
+	struct stat linkedStatus;
+	EXPECT(stat(fileNames.at(0).c_str(), &sourceStatus) == 0);
+	EXPECT(lstat(linked.c_str(), &linkedStatus) == 0);
+	EXPECT(S_ISREG(linkedStatus.st_mode));
+	if (sourceStatus.st_dev == linkedStatus.st_dev) {
+		EXPECT_EQ(sourceStatus.st_ino, linkedStatus.st_ino);
+	}
+	EXPECT_EQ(ruc::File(linked.string()).data(), fileContents.at(0));
+
+	// A hardlinked source that gets a block is rendered into a copy on the next push
+	ruc::File(fileNames.at(0)).append(block).flush();
+	Config::the().setDeploy(Config::Deploy::Hardlink);
+	Dotfile::the().push(fileNames);
+	Config::the().setDeploy(Config::Deploy::Copy);
+
+	EXPECT(stat(fileNames.at(0).c_str(), &sourceStatus) == 0);
+	EXPECT(lstat(linked.c_str(), &linkedStatus) == 0);
+	EXPECT(sourceStatus.st_ino != linkedStatus.st_ino);
+	EXPECT_EQ(ruc::File(fileNames.at(0)).data(), fileContents.at(0) + block);
+	EXPECT_EQ(ruc::File(linked.string()).data(), "plain file\n# >>> distro=" + Machine::the().distroId() + "\nblock\n# <<<\n");
+
+	removeTestDotfiles(fileNames);
+}
+
 TEST_CASE(AddSystemDotfiles)
 {
 	EXPECT(geteuid() == 0, return);
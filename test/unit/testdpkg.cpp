@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <filesystem> // path
+#include <string>
+#include <vector>
+#include <zlib.h> // gzclose, gzopen, gzwrite
+
+#include "ruc/file.h"
+
+#include "dpkg.h"
+#include "macro.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path dpkgDirectory = std::filesystem::current_path() / "__dpkg";
+
+void createDpkgFile(const std::filesystem::path& path, const std::string& contents)
+{
+	std::filesystem::create_directories((dpkgDirectory / path).parent_path());
+	ruc::File::create((dpkgDirectory / path).string());
+	ruc::File((dpkgDirectory / path).string()).append(contents).flush();
+}
+
+// -----------------------------------------
+
+TEST_CASE(DpkgManualPackages)
+{
+	createDpkgFile("var/lib/dpkg/status", R"(Package: base-files
+Status: install ok installed
+Priority: required
+Architecture: amd64
+Description: Debian base system miscellaneous files
+ This package contains the basic filesystem hierarchy.
+
+Package: curl
+Status: install ok installed
+Priority: optional
+Architecture: amd64
+
+Package: libcurl4
+Status: install ok installed
+Priority: optional
+Architecture: amd64
+
+Package: libc6
+Status: install ok installed
+Priority: optional
+Architecture: amd64
+
+Package: libc6
+Status: install ok installed
+Priority: optional
+Architecture: i386
+
+Package: neovim
+Status: hold ok installed
+Priority: optional
+
+Package: vim
+Status: deinstall ok config-files
+Priority: optional
+
+Package: less
+Status: install ok installed
+Priority: important
+
+Package: zsh
+Status: install ok installed
+Priority: optional
+
+Package: ripgrep
+Status: install ok installed
+Priority: optional
+)");
+
+	createDpkgFile("var/lib/apt/extended_states", R"(Package: libcurl4
+Architecture: amd64
+Auto-Installed: 1
+
+Package: libc6
+Architecture: amd64
+Auto-Installed: 0
+
+Package: zsh
+Architecture: amd64
+Auto-Installed: 1
+
+Package: ripgrep
+Architecture: amd64
+Auto-Installed: 1
+)");
+
+	// Automatically installed, but once installed with apt install
+	createDpkgFile("var/log/apt/history.log", R"(
+Start-Date: 2026-01-01  10:00:00
+Commandline: apt install zsh
+Install: zsh:amd64 (5.9-4)
+End-Date: 2026-01-01  10:00:01
+
+Start-Date: 2026-01-02  10:00:00
+Commandline: /usr/bin/unattended-upgrade -o APT::Get::Install-Recommends=true install libcurl4
+End-Date: 2026-01-02  10:00:01
+)");
+
+	std::string rotated = "Start-Date: 2025-12-01  10:00:00\nCommandline: apt-get -y install ripgrep\n";
+	gzFile file = gzopen((dpkgDirectory / "var/log/apt/history.log.2.gz").c_str(), "wb");
+	EXPECT(file != nullptr, return);
+	gzwrite(file, rotated.data(), rotated.size());
+	gzclose(file);
+
+	std::vector<std::string> packages;
+	EXPECT(Dpkg(dpkgDirectory).manualPackages(packages));
+	EXPECT(packages == std::vector<std::string>({ "curl", "libc6", "neovim", "ripgrep", "zsh" }));
+
+	// A missing status file
+	EXPECT(!Dpkg(dpkgDirectory / "__missing").manualPackages(packages));
+
+	std::filesystem::remove_all(dpkgDirectory);
+}
+
+TEST_CASE(DpkgStanzas)
+{
+	size_t count = 0;
+	Dpkg::forEachStanza("A: 1\nB:  two\n words\n\n\nA: 3", [&count](const auto& fields) {
+		count++;
+		if (count == 1) {
+			EXPECT_EQ(fields.size(), 2, return);
+			EXPECT_EQ(std::string(fields.at(0).first), "A");
+			EXPECT_EQ(std::string(fields.at(0).second), "1");
+			EXPECT_EQ(std::string(fields.at(1).second), "two\n words");
+		}
+		else {
+			EXPECT_EQ(fields.size(), 1, return);
+			EXPECT_EQ(std::string(fields.at(0).second), "3");
+		}
+	});
+	EXPECT_EQ(count, 2);
+}
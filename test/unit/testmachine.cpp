@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstdlib>    // getenv, setenv, unsetenv
+#include <filesystem> // path
+#include <optional>
+#include <string>
+
+#include "cache.h"
+#include "machine.h"
+#include "macro.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path runtimeDirectory = std::filesystem::current_path() / "__runtime";
+
+// -----------------------------------------
+
+TEST_CASE(MachineFactsCache)
+{
+	const char* env = std::getenv("XDG_RUNTIME_DIR");
+	std::optional<std::string> previous;
+	if (env != nullptr) {
+		previous = env;
+	}
+	std::filesystem::create_directories(runtimeDirectory);
+	setenv("XDG_RUNTIME_DIR", runtimeDirectory.c_str(), 1);
+
+	// Fetched facts are stored for the next run
+	Machine::destroy();
+	std::string distroId = Machine::the().distroId();
+	std::string hostname = Machine::the().hostname();
+	auto cacheFile = runtimeDirectory / "manafiles" / "machine";
+
+	// The cache is written once, after the facts are fetched
+	EXPECT(!Cache::read(cacheFile).has_value());
+	Machine::the().writeCache();
+	auto cache = Cache::read(cacheFile);
+	EXPECT(cache.has_value());
+	if (cache.has_value()) {
+		EXPECT(cache->find("\ndistroId=" + distroId + "\n") != std::string::npos);
+		EXPECT(cache->find("\nhostname=" + hostname + "\n") != std::string::npos);
+		EXPECT(cache->find("session=") == std::string::npos);
+
+		// The next run reads them from the cache
+		size_t position = cache->find("hostname=");
+		cache->replace(position, cache->find('\n', position) - position, "hostname=__cached");
+		EXPECT(Cache::write(cacheFile, cache.value()));
+		Machine::destroy();
+		EXPECT_EQ(Machine::the().hostname(), "__cached");
+		EXPECT_EQ(Machine::the().distroId(), distroId);
+
+		// Unless it is bypassed
+		Machine::destroy();
+		Machine::the().setCache(false);
+		EXPECT_EQ(Machine::the().hostname(), hostname);
+	}
+
+	// The session is cached per value of the session environment variables
+	const char* sessionType = std::getenv("XDG_SESSION_TYPE");
+	std::optional<std::string> previousSessionType;
+	if (sessionType != nullptr) {
+		previousSessionType = sessionType;
+	}
+	setenv("XDG_SESSION_TYPE", "x11", 1);
+	Machine::destroy();
+	std::string session = Machine::the().session();
+	Machine::destroy();
+	cache = Cache::read(cacheFile);
+	EXPECT(cache.has_value());
+	if (cache.has_value()) {
+		size_t position = cache->find("\nsession.");
+		EXPECT(position != std::string::npos);
+		if (position != std::string::npos) {
+			position = cache->find('=', position) + 1;
+			cache->replace(position, cache->find('\n', position) - position, "__cached");
+			EXPECT(Cache::write(cacheFile, cache.value()));
+		}
+		EXPECT_EQ(Machine::the().session(), "__cached");
+
+		setenv("XDG_SESSION_TYPE", "wayland", 1);
+		Machine::destroy();
+		EXPECT(Machine::the().session() != "__cached");
+	}
+	if (previousSessionType.has_value()) {
+		setenv("XDG_SESSION_TYPE", previousSessionType->c_str(), 1);
+	}
+	else {
+		unsetenv("XDG_SESSION_TYPE");
+	}
+
+	// The cache belongs to a single boot
+	Machine::destroy();
+	std::string key = "00000000-0000-0000-0000-000000000000\n0.0\n";
+	EXPECT(Cache::write(cacheFile, key + "hostname=__stale\n"));
+	EXPECT_EQ(Machine::the().hostname(), hostname);
+
+	Machine::destroy();
+	if (previous.has_value()) {
+		setenv("XDG_RUNTIME_DIR", previous->c_str(), 1);
+	}
+	else {
+		unsetenv("XDG_RUNTIME_DIR");
+	}
+	std::filesystem::remove_all(runtimeDirectory);
+}
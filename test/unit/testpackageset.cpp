@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef> // size_t
+#include <cstdio>  // printf
+#include <string>
+#include <vector>
+
+#include "ruc/timer.h"
+
+#include "macro.h"
+#include "packageset.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+// -----------------------------------------
+
+TEST_CASE(PackageSetOperations)
+{
+	auto installed = PackageSet::fromLines("zsh\nneovim\n  curl \n\ngit\nneovim\r\n");
+	EXPECT(installed.names() == std::vector<std::string>({ "curl", "git", "neovim", "zsh" }));
+
+	PackageSet wanted({ "zsh", "firefox", "git", "yay" });
+	EXPECT_EQ(installed.intersection(wanted).join(), "git\nzsh\n");
+	EXPECT_EQ(wanted.difference(installed).join(' '), "firefox yay ");
+	EXPECT_EQ(installed.unite(wanted).size(), 6);
+
+	EXPECT(installed.contains("neovim"));
+	EXPECT(!installed.contains("neovi"));
+
+	EXPECT(PackageSet().intersection(installed).empty());
+	EXPECT_EQ(installed.difference(PackageSet()).size(), installed.size());
+}
+
+TEST_CASE(PackageSetBenchmark)
+{
+	// The set operations should scale linearly with the amount of packages
+	auto diff = [](size_t count) -> double {
+		std::string repository;
+		std::vector<std::string> wanted;
+		for (size_t i = 0; i < count; ++i) {
+			repository.append("package-" + std::to_string(i) + '\n');
+			if (i % 10 == 0) {
+				wanted.push_back("package-" + std::to_string(i * 2));
+			}
+		}
+
+		ruc::Timer timer;
+		auto repositoryPackages = PackageSet::fromLines(repository);
+		PackageSet wantedPackages(wanted);
+		auto repoPackages = repositoryPackages.intersection(wantedPackages);
+		auto aurPackages = wantedPackages.difference(repoPackages);
+		double elapsed = timer.elapsedNanoseconds() / 1000000.0;
+
+		EXPECT_EQ(repoPackages.size() + aurPackages.size(), wantedPackages.size());
+
+		return elapsed;
+	};
+
+	double small = diff(10000);
+	double large = diff(80000);
+	printf("        10000 packages: %fms, 80000 packages: %fms\n", small, large);
+
+	EXPECT(large < small * 16 + 5.0);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>  // sort
+#include <filesystem> // path
+#include <string>
+#include <vector>
+
+#include "ruc/file.h"
+
+#include "macro.h"
+#include "pacman.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path pacmanDirectory = std::filesystem::current_path() / "__pacman";
+
+// Add a package to the local database of the fixture
+void createLocalPackage(const std::string& name, bool explicitly,
+                        const std::vector<std::string>& depends,
+                        const std::vector<std::string>& provides = {},
+                        const std::vector<std::string>& groups = {})
+{
+	auto directory = pacmanDirectory / "local" / (name + "-1.0-1");
+	std::filesystem::create_directories(directory);
+
+	std::string desc = "%NAME%\n" + name + "\n\n%VERSION%\n1.0-1\n\n%DESC%\nThe " + name + " package\n\n";
+	if (!groups.empty()) {
+		desc += "%GROUPS%\n";
+		for (const auto& group : groups) {
+			desc += group + '\n';
+		}
+		desc += '\n';
+	}
+	if (!explicitly) {
+		desc += "%REASON%\n1\n\n";
+	}
+	if (!depends.empty()) {
+		desc += "%DEPENDS%\n";
+		for (const auto& depend : depends) {
+			desc += depend + '\n';
+		}
+		desc += '\n';
+	}
+	if (!provides.empty()) {
+		desc += "%PROVIDES%\n";
+		for (const auto& provide : provides) {
+			desc += provide + '\n';
+		}
+		desc += '\n';
+	}
+
+	ruc::File::create((directory / "desc").string());
+	ruc::File((directory / "desc").string()).append(desc).flush();
+}
+
+// -----------------------------------------
+
+TEST_CASE(PacmanLocalDatabase)
+{
+	std::filesystem::create_directories(pacmanDirectory / "local");
+	ruc::File::create((pacmanDirectory / "local" / "ALPM_DB_VERSION").string());
+	ruc::File((pacmanDirectory / "local" / "ALPM_DB_VERSION").string()).append("9\n").flush();
+
+	// base pulls in bash via a versioned dependency and sh via a provider
+	createLocalPackage("base", true, { "bash>=5.0", "filesystem", "sh" });
+	createLocalPackage("bash", false, { "glibc" }, { "sh=5.2" });
+	createLocalPackage("filesystem", false, { "iana-etc" });
+	createLocalPackage("glibc", false, { "filesystem" });
+	createLocalPackage("iana-etc", false, {});
+	// Explicitly installed, but part of base
+	createLocalPackage("linux-firmware", true, {});
+	createLocalPackage("base-extra", false, { "linux-firmware" });
+	createLocalPackage("gcc", true, { "glibc" }, {}, { "base-devel" });
+	createLocalPackage("make", true, {}, {}, { "base-devel" });
+	createLocalPackage("neovim", true, { "libuv", "missing-dependency" });
+	createLocalPackage("libuv", false, {});
+	createLocalPackage("zsh", true, {});
+
+	Pacman pacman(pacmanDirectory);
+	EXPECT(pacman.readLocal(), return);
+	EXPECT_EQ(pacman.packages().size(), 12);
+
+	auto closure = pacman.dependencyClosure("base");
+	std::sort(closure.begin(), closure.end());
+	EXPECT(closure == std::vector<std::string>({ "bash", "filesystem", "glibc", "iana-etc" }));
+
+	auto group = pacman.groupMembers("base-devel");
+	std::sort(group.begin(), group.end());
+	EXPECT(group == std::vector<std::string>({ "gcc", "make" }));
+
+	// Like pacman -Qqe, without the base closure and the base-devel group
+	EXPECT(pacman.explicitPackages() == std::vector<std::string>({ "base", "linux-firmware", "neovim", "zsh" }));
+
+	// A missing database
+	Pacman missing(pacmanDirectory / "__missing");
+	EXPECT(!missing.readLocal());
+
+	// An entry without a desc file
+	std::filesystem::create_directories(pacmanDirectory / "local" / "__partial-1.0-1");
+	EXPECT(!pacman.readLocal());
+
+	std::filesystem::remove_all(pacmanDirectory);
+}
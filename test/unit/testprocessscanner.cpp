@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>  // min
+#include <cstddef>    // size_t
+#include <cstdio>     // printf
+#include <filesystem> // path
+#include <fstream>    // ifstream
+#include <string>
+#include <string_view>
+
+#include "ruc/file.h"
+#include "ruc/timer.h"
+
+#include "macro.h"
+#include "processscanner.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path procDirectory = std::filesystem::current_path() / "__proc";
+
+// Create a /proc-like directory, the last process has the given command name
+void createTestProc(size_t processCount, const std::string& lastCommand)
+{
+	std::filesystem::create_directories(procDirectory / "self");
+	ruc::File::create((procDirectory / "cpuinfo").string());
+
+	for (size_t i = 1; i <= processCount; ++i) {
+		auto process = procDirectory / std::to_string(i);
+		std::filesystem::create_directories(process);
+		ruc::File::create((process / "comm").string());
+		ruc::File((process / "comm").string()).append((i == processCount ? lastCommand : "bash") + "\n").flush();
+	}
+
+	// A process that exited while scanning
+	std::filesystem::create_directories(procDirectory / std::to_string(processCount + 1));
+}
+
+// -----------------------------------------
+
+TEST_CASE(ProcessScannerReadsCommands)
+{
+	createTestProc(100, "Xorg");
+
+	size_t processes = 0;
+	size_t xorg = 0;
+	EXPECT(ProcessScanner::scan(procDirectory.string(), [&](std::string_view command) -> bool {
+		processes++;
+		if (command == "Xorg") {
+			xorg++;
+		}
+		return true;
+	}));
+	EXPECT_EQ(processes, 100);
+	EXPECT_EQ(xorg, 1);
+
+	// Stops as soon as the callback is done
+	processes = 0;
+	ProcessScanner::scan(procDirectory.string(), [&processes](std::string_view) -> bool {
+		processes++;
+		return false;
+	});
+	EXPECT_EQ(processes, 1);
+
+	EXPECT(!ProcessScanner::scan((procDirectory / "__missing").string(), [](std::string_view) -> bool { return true; }));
+
+	std::filesystem::remove_all(procDirectory);
+}
+
+TEST_CASE(ProcessScannerBenchmark)
+{
+	createTestProc(5000, "Xorg");
+
+	// The way processes were scanned before, with a path and stream per process
+	auto scanWithStreams = []() -> bool {
+		for (const auto& entry : std::filesystem::directory_iterator(procDirectory)) {
+			if (std::filesystem::is_directory(entry)) {
+				std::filesystem::path comm = entry.path() / "comm";
+				if (!std::filesystem::exists(comm)) {
+					continue;
+				}
+
+				std::ifstream stream(comm);
+				std::string command;
+				std::getline(stream, command);
+				if (command == "Xorg") {
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+
+	auto scan = []() -> bool {
+		bool found = false;
+		ProcessScanner::scan(procDirectory.string(), [&found](std::string_view command) -> bool {
+			found = command == "Xorg";
+			return !found;
+		});
+		return found;
+	};
+
+	double streams = 0;
+	double scanner = 0;
+	for (size_t i = 0; i < 3; ++i) {
+		ruc::Timer timer;
+		EXPECT(scanWithStreams());
+		double elapsed = timer.elapsedNanoseconds() / 1000000.0;
+		streams = (i == 0) ? elapsed : std::min(streams, elapsed);
+
+		timer = ruc::Timer();
+		EXPECT(scan());
+		elapsed = timer.elapsedNanoseconds() / 1000000.0;
+		scanner = (i == 0) ? elapsed : std::min(scanner, elapsed);
+	}
+	printf("        5000 processes, streams: %fms, scanner: %fms\n", streams, scanner);
+
+	EXPECT(scanner < streams);
+
+	std::filesystem::remove_all(procDirectory);
+}
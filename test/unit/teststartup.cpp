@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>  // min
+#include <cstddef>    // size_t
+#include <cstdio>     // printf
+#include <cstdlib>    // setenv, unsetenv
+#include <fcntl.h>    // O_CREAT, O_RDWR, O_TRUNC, O_WRONLY, open
+#include <filesystem> // path
+#include <string>
+#include <sys/wait.h>   // waitpid
+#include <system_error> // error_code
+#include <unistd.h>     // _exit, chdir, dup2, execv, fork
+#include <vector>
+
+#include "ruc/file.h"
+#include "ruc/timer.h"
+
+#include "macro.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path startupDirectory = std::filesystem::current_path() / "__startup";
+
+// Fastest wall time of running the manafiles program in the directory, in milliseconds
+double runManafiles(const std::filesystem::path& program, const std::filesystem::path& directory,
+                    const std::vector<std::string>& arguments, const std::filesystem::path& output = "/dev/null",
+                    const std::filesystem::path& errors = "/dev/null")
+{
+	double fastest = 0;
+	for (size_t i = 0; i < 3; ++i) {
+		ruc::Timer timer;
+		pid_t pid = fork();
+		if (pid == 0) {
+			// Keep the caches of the runs out of the home directory
+			setenv("XDG_CACHE_HOME", (startupDirectory / "__cache").c_str(), 1);
+			unsetenv("XDG_RUNTIME_DIR");
+
+			int null = open("/dev/null", O_RDWR);
+			int out = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			int err = open(errors.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			dup2(null, 0);
+			dup2(out, 1);
+			dup2(err, 2);
+			if (chdir(directory.c_str()) != 0) {
+				_exit(1);
+			}
+
+			std::vector<char*> argv { const_cast<char*>(program.c_str()) };
+			for (const auto& argument : arguments) {
+				argv.push_back(const_cast<char*>(argument.c_str()));
+			}
+			argv.push_back(nullptr);
+			execv(program.c_str(), argv.data());
+			_exit(1);
+		}
+
+		int status = 0;
+		waitpid(pid, &status, 0);
+		double elapsed = timer.elapsedNanoseconds() / 1000000.0;
+		fastest = (i == 0) ? elapsed : std::min(fastest, elapsed);
+	}
+
+	return fastest;
+}
+
+// The manafiles program, which is built next to the test program
+std::filesystem::path findManafiles()
+{
+	std::error_code error;
+	auto program = std::filesystem::read_symlink("/proc/self/exe", error).parent_path() / "manafiles";
+	if (error || !std::filesystem::is_regular_file(program)) {
+		printf("        manafiles program not found, skipped\n");
+		return {};
+	}
+
+	return program;
+}
+
+// -----------------------------------------
+
+TEST_CASE(StartupBenchmark)
+{
+	auto program = findManafiles();
+	if (program.empty()) {
+		return;
+	}
+
+	auto empty = startupDirectory / "__empty";
+	auto large = startupDirectory / "__large";
+	std::filesystem::create_directories(empty);
+	for (size_t i = 0; i < 4000; ++i) {
+		auto directory = large / ("__dir-" + std::to_string(i % 100));
+		std::filesystem::create_directories(directory);
+		ruc::File::create((directory / ("__file-" + std::to_string(i))).string());
+	}
+
+	// Loading this config reports the unknown deploy mode
+	ruc::File::create((large / "manafiles.json").string());
+	ruc::File((large / "manafiles.json").string()).append("{ \"deploy\": \"__unknown\" }\n").flush();
+
+	const std::vector<std::vector<std::string>> operations = {
+		{ "-F" },
+		{ "-Fs", "__nothing" },
+		{ "-P", "__nothing" },
+	};
+
+	double times[3][2];
+	for (size_t i = 0; i < operations.size(); ++i) {
+		times[i][0] = runManafiles(program, empty, operations.at(i));
+		times[i][1] = runManafiles(program, large, operations.at(i));
+		printf("        %-14s empty tree: %fms, 4000 files: %fms\n",
+		       (operations.at(i).at(0) + (operations.at(i).size() > 1 ? " " + operations.at(i).at(1) : "")).c_str(),
+		       times[i][0], times[i][1]);
+	}
+
+	// Package operations dont look at the working directory, so the config is never loaded
+	auto errors = startupDirectory / "__errors";
+	runManafiles(program, large, { "-F" }, "/dev/null", errors);
+	EXPECT(ruc::File(errors.string()).data().find("unknown deploy mode") != std::string::npos);
+	runManafiles(program, large, { "-P", "__nothing" }, "/dev/null", errors);
+	EXPECT(ruc::File(errors.string()).data().find("Config:") == std::string::npos);
+
+	std::filesystem::remove_all(startupDirectory);
+}
+
+TEST_CASE(StartupPackageListCache)
+{
+	auto program = findManafiles();
+	if (program.empty()) {
+		return;
+	}
+
+	std::filesystem::create_directories(startupDirectory);
+	auto output = startupDirectory / "__output";
+	auto printed = [&output]() -> std::string {
+		std::string data = ruc::File(output.string()).data();
+#ifndef NDEBUG
+		// Debug builds print the time taken last
+		size_t lastLine = data.rfind('\n', data.size() - 2);
+		data.erase(lastLine == std::string::npos ? 0 : lastLine + 1);
+#endif
+		return data;
+	};
+	auto cacheFile = startupDirectory / "__cache" / "manafiles" / "packages";
+	double uncached = runManafiles(program, startupDirectory, { "-Pn" }, output);
+	runManafiles(program, startupDirectory, { "-P" }, output);
+	if (!std::filesystem::exists(cacheFile)) {
+		printf("        package database not supported, skipped\n");
+		std::filesystem::remove_all(startupDirectory);
+		return;
+	}
+	std::string packages = printed();
+
+	// The cache starts with the key of the database, followed by the list as printed
+	std::string data = ruc::File(cacheFile.string()).data();
+	size_t keyEnd = data.find('\n');
+	EXPECT(data.starts_with("packages 1 "));
+	EXPECT_EQ(data.substr(keyEnd + 1), packages);
+
+	double cached = runManafiles(program, startupDirectory, { "-P" }, output);
+	EXPECT_EQ(printed(), packages);
+	printf("        -P without cache: %fms, with cache: %fms\n", uncached, cached);
+
+	// An unchanged database returns the cached list, which is replaced here
+	std::filesystem::remove(cacheFile);
+	ruc::File::create(cacheFile.string());
+	ruc::File(cacheFile.string()).append(data.substr(0, keyEnd + 1) + "__cached\n").flush();
+	runManafiles(program, startupDirectory, { "-P" }, output);
+	EXPECT_EQ(printed(), "__cached\n");
+
+	// Unless the cache is skipped
+	runManafiles(program, startupDirectory, { "-Pn" }, output);
+	EXPECT_EQ(printed(), packages);
+	EXPECT_EQ(ruc::File(cacheFile.string()).data(), data.substr(0, keyEnd + 1) + "__cached\n");
+
+	// A cache with a different key is rebuilt, a deleted one too
+	std::filesystem::remove(cacheFile);
+	ruc::File::create(cacheFile.string());
+	ruc::File(cacheFile.string()).append("packages 1 0 -\n__stale\n").flush();
+	runManafiles(program, startupDirectory, { "-P" }, output);
+	EXPECT_EQ(printed(), packages);
+	std::filesystem::remove(cacheFile);
+	runManafiles(program, startupDirectory, { "-P" }, output);
+	EXPECT_EQ(printed(), packages);
+
+	std::filesystem::remove_all(startupDirectory);
+}
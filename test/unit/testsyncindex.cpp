@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>  // min
+#include <cstddef>    // size_t
+#include <cstdio>     // snprintf
+#include <cstring>    // memcpy, memset
+#include <filesystem> // path
+#include <string>
+#include <vector>
+#include <zlib.h> // gzclose, gzopen, gzwrite
+
+#include "ruc/file.h"
+
+#include "macro.h"
+#include "packageset.h"
+#include "syncindex.h"
+#include "testcase.h"
+#include "testsuite.h"
+
+const std::filesystem::path syncIndexDirectory = std::filesystem::current_path() / "__syncindex";
+
+// Append a ustar entry to a tar archive
+void appendTarEntry(std::string& archive, const std::string& name, const std::string& contents, char type = '0')
+{
+	char header[512];
+	memset(header, 0, sizeof(header));
+	memcpy(header, name.data(), std::min<size_t>(name.size(), 100));
+	snprintf(header + 100, 8, "%07o", type == '5' ? 0755 : 0644);
+	snprintf(header + 124, 12, "%011zo", contents.size());
+	header[156] = type;
+	memcpy(header + 257, "ustar\0" "00", 8);
+
+	memset(header + 148, ' ', 8);
+	unsigned checksum = 0;
+	for (unsigned char byte : header) {
+		checksum += byte;
+	}
+	snprintf(header + 148, 8, "%06o", checksum);
+
+	archive.append(header, sizeof(header));
+	archive.append(contents);
+	archive.append((512 - contents.size() % 512) % 512, '\0');
+}
+
+// Write a gzip compressed sync database of the fixture
+void createSyncDatabase(const std::string& repository, const std::vector<std::string>& packages)
+{
+	std::string archive;
+	for (const auto& package : packages) {
+		auto directory = package + "-1.0-1";
+		appendTarEntry(archive, directory + '/', "", '5');
+		appendTarEntry(archive, directory + "/desc", "%NAME%\n" + package + "\n\n%VERSION%\n1.0-1\n\n");
+	}
+	archive.append(1024, '\0');
+
+	std::filesystem::create_directories(syncIndexDirectory / "sync");
+	auto path = syncIndexDirectory / "sync" / (repository + ".db");
+	gzFile file = gzopen(path.c_str(), "wb");
+	gzwrite(file, archive.data(), archive.size());
+	gzclose(file);
+}
+
+// -----------------------------------------
+
+TEST_CASE(SyncIndexPacmanDatabases)
+{
+	createSyncDatabase("core", { "base", "bash", "linux-firmware" });
+	createSyncDatabase("extra", { "neovim", "python-pip", "zsh" });
+	// Signatures next to the databases are not read
+	ruc::File::create((syncIndexDirectory / "sync" / "core.db.sig").string());
+
+	// Package names longer than the tar header holds, GNU style
+	std::string longName(120, 'x');
+	std::string archive;
+	appendTarEntry(archive, "././@LongLink", longName + "-1.0-1/desc", 'L');
+	appendTarEntry(archive, "truncated", "%NAME%\n");
+	archive.append(1024, '\0');
+	ruc::File::create((syncIndexDirectory / "sync" / "long.db").string());
+	ruc::File((syncIndexDirectory / "sync" / "long.db").string()).append(archive).flush();
+
+	SyncIndex index(2);
+	EXPECT(index.readPacman(syncIndexDirectory), return);
+	EXPECT_EQ(index.size(), 7);
+	EXPECT(index.contains("linux-firmware"));
+	EXPECT(index.contains("python-pip"));
+	EXPECT(index.contains(longName));
+	EXPECT(!index.contains("yay"));
+
+	// The list, without the AUR packages
+	auto packages = PackageSet::fromLines("bash\nneovim\nyay\nzsh\n");
+	EXPECT_EQ(index.filter(packages).join(' '), "bash neovim zsh ");
+
+	// A missing database
+	SyncIndex missing;
+	EXPECT(!missing.readPacman(syncIndexDirectory / "__missing"));
+
+	// Not a tar archive
+	ruc::File::create((syncIndexDirectory / "sync" / "corrupt.db").string());
+	ruc::File((syncIndexDirectory / "sync" / "corrupt.db").string()).append(std::string(1024, 'x')).flush();
+	SyncIndex corrupt;
+	EXPECT(!corrupt.readPacman(syncIndexDirectory));
+
+	std::filesystem::remove_all(syncIndexDirectory);
+}
+
+TEST_CASE(SyncIndexAptLists)
+{
+	std::filesystem::create_directories(syncIndexDirectory);
+
+	auto main = syncIndexDirectory / "deb.debian.org_debian_dists_stable_main_binary-amd64_Packages";
+	ruc::File::create(main.string());
+	ruc::File(main.string()).append("Package: bash\nVersion: 5.2\nDescription: GNU Bourne Again SHell\n\n"
+	                                "Package: neovim\nVersion: 0.7\nDescription: heavily refactored vim fork\n"
+	                                " Package: not-a-package\n").flush();
+
+	auto contrib = syncIndexDirectory / "deb.debian.org_debian_dists_stable_contrib_binary-amd64_Packages.gz";
+	std::string contents = "Package: zsh\nVersion: 5.9\n\nPackage: tmux\nVersion: 3.3\n";
+	gzFile file = gzopen(contrib.c_str(), "wb");
+	gzwrite(file, contents.data(), contents.size());
+	gzclose(file);
+
+	// Other indices in the lists directory are not read
+	ruc::File::create((syncIndexDirectory / "deb.debian.org_debian_dists_stable_InRelease").string());
+	ruc::File((syncIndexDirectory / "deb.debian.org_debian_dists_stable_InRelease").string()).append("Package: release\n").flush();
+
+	SyncIndex index;
+	EXPECT(index.readApt(syncIndexDirectory), return);
+	EXPECT_EQ(index.size(), 4);
+	EXPECT(index.contains("bash"));
+	EXPECT(index.contains("tmux"));
+	EXPECT(!index.contains("not-a-package"));
+	EXPECT(!index.contains("release"));
+
+	// An empty lists directory, before apt update
+	std::filesystem::create_directories(syncIndexDirectory / "__empty");
+	SyncIndex empty;
+	EXPECT(!empty.readApt(syncIndexDirectory / "__empty"));
+
+	std::filesystem::remove_all(syncIndexDirectory);
+}
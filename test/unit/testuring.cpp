@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cerrno>          // ENOENT, EPERM
+#include <csignal>         // kill, SIGKILL
+#include <cstddef>         // offsetof, size_t
+#include <cstdio>          // printf
+#include <filesystem>      // path
+#include <linux/filter.h>  // BPF_JUMP, BPF_STMT, sock_filter, sock_fprog
+#include <linux/seccomp.h> // SECCOMP_RET_ALLOW, SECCOMP_RET_ERRNO, seccomp_data
+#include <string>
+#include <sys/prctl.h>   // PR_SET_NO_NEW_PRIVS, PR_SET_SECCOMP, prctl
+#include <sys/stat.h>    // lstat
+#include <sys/syscall.h> // SYS_io_uring_enter
+#include <sys/wait.h>    // WEXITSTATUS, WIFEXITED, WNOHANG, waitpid
+#include <unistd.h>      // _exit, fork, usleep
+#include <vector>
+
+#include "ruc/file.h"
+
+#include "macro.h"
+#include "testcase.h"
+#include "testsuite.h"
+#include "uring.h"
+
+const std::filesystem::path uringDirectory = std::filesystem::current_path() / "__uring";
+
+// -----------------------------------------
+
+TEST_CASE(UringStatMatchesLstat)
+{
+	std::filesystem::create_directories(uringDirectory);
+
+	// More paths than entries in the ring, so it takes multiple batches
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < 20; ++i) {
+		auto file = (uringDirectory / ("__file-" + std::to_string(i))).string();
+		ruc::File::create(file);
+		ruc::File(file).append(std::string(i, 'x')).flush();
+		paths.push_back(file);
+	}
+	std::filesystem::create_symlink("__file-1", uringDirectory / "__link");
+	paths.push_back((uringDirectory / "__link").string());
+	paths.push_back(uringDirectory.string());
+	paths.push_back((uringDirectory / "__missing").string());
+
+	Uring uring(8);
+	std::vector<struct stat> statuses;
+	std::vector<int> errors;
+	uring.lstat(paths, statuses, errors);
+
+	EXPECT_EQ(statuses.size(), paths.size(), return);
+	EXPECT_EQ(errors.size(), paths.size(), return);
+	for (size_t i = 0; i < paths.size(); ++i) {
+		struct stat expected;
+		if (lstat(paths.at(i).c_str(), &expected) != 0) {
+			EXPECT_EQ(errors.at(i), ENOENT);
+			continue;
+		}
+
+		EXPECT_EQ(errors.at(i), 0, continue);
+		EXPECT_EQ(statuses.at(i).st_dev, expected.st_dev);
+		EXPECT_EQ(statuses.at(i).st_ino, expected.st_ino);
+		EXPECT_EQ(statuses.at(i).st_mode, expected.st_mode);
+		EXPECT_EQ(statuses.at(i).st_size, expected.st_size);
+		EXPECT_EQ(statuses.at(i).st_mtim.tv_sec, expected.st_mtim.tv_sec);
+		EXPECT_EQ(statuses.at(i).st_mtim.tv_nsec, expected.st_mtim.tv_nsec);
+	}
+
+	std::filesystem::remove_all(uringDirectory);
+}
+
+TEST_CASE(UringFallsBackWhenEnterFails)
+{
+	std::filesystem::create_directories(uringDirectory);
+
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < 256; ++i) {
+		auto file = (uringDirectory / ("__file-" + std::to_string(i))).string();
+		ruc::File::create(file);
+		ruc::File(file).append(std::string(i, 'x')).flush();
+		paths.push_back(file);
+	}
+
+	// Check that every path is stat'ed, in a child with io_uring_enter failing
+	// once it submits nothing or on every call, so the ring breaks down with
+	// requests in flight or before submitting any
+	pid_t pid = fork();
+	if (pid == 0) {
+		auto fail = [](bool always) -> bool {
+			struct sock_filter filter[] = {
+				BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+				BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SYS_io_uring_enter, 0, 3),
+				BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, args[1])),
+				BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, !always),
+				BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+				BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+			};
+			struct sock_fprog program = { sizeof(filter) / sizeof(filter[0]), filter };
+			return prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0 && prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) == 0;
+		};
+
+		auto statted = [&paths]() -> bool {
+			Uring uring(256);
+			std::vector<struct stat> statuses;
+			std::vector<int> errors;
+			uring.lstat(paths, statuses, errors);
+
+			for (size_t i = 0; i < paths.size(); ++i) {
+				struct stat expected;
+				if (lstat(paths.at(i).c_str(), &expected) != 0 || errors.at(i) != 0
+				    || statuses.at(i).st_ino != expected.st_ino || statuses.at(i).st_size != expected.st_size) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+		if (!fail(false)) {
+			_exit(2);
+		}
+		if (!statted()) {
+			_exit(3);
+		}
+		if (!fail(true)) {
+			_exit(2);
+		}
+		_exit(statted() ? 0 : 4);
+	}
+
+	// Give up on a child that keeps waiting on the ring
+	int status = 0;
+	pid_t result = 0;
+	for (size_t i = 0; i < 1000 && result == 0; ++i) {
+		result = waitpid(pid, &status, WNOHANG);
+		if (result == 0) {
+			usleep(10000);
+		}
+	}
+	if (result == 0) {
+		kill(pid, SIGKILL);
+		waitpid(pid, &status, 0);
+	}
+
+	EXPECT(result == pid);
+	EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0, printf("        status = %d\n", status));
+
+	std::filesystem::remove_all(uringDirectory);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>  // is_sorted
+#include <chrono>     // milliseconds
+#include <cstddef>    // size_t
+#include <cstdio>     // printf
+#include <filesystem> // path
+#include <string>
+#include <sys/resource.h> // getrusage
+#include <thread>         // sleep_for
+#include <vector>
+
+#include "ruc/file.h"
+
+#include "macro.h"
+#include "testcase.h"
+#include "testsuite.h"
+#include "walker.h"
+
+const std::filesystem::path walkerDirectory = std::filesystem::current_path() / "__walker";
+
+void createWalkerTree(size_t directoryCount, size_t fileCount)
+{
+	for (size_t i = 0; i < directoryCount; ++i) {
+		auto directory = walkerDirectory / ("__dir-" + std::to_string(i)) / "__subdir";
+		std::filesystem::create_directories(directory);
+		for (size_t j = 0; j < fileCount; ++j) {
+			ruc::File::create((directory / ("__file-" + std::to_string(j))).string());
+		}
+	}
+	std::filesystem::create_directories(walkerDirectory / "__pruned");
+	ruc::File::create((walkerDirectory / "__pruned" / "__file").string());
+}
+
+// -----------------------------------------
+
+TEST_CASE(WalkerSortedAndDeterministic)
+{
+	createWalkerTree(20, 10);
+
+	auto descend = [](const std::filesystem::directory_entry& directory) -> bool {
+		return directory.path().filename() != "__pruned";
+	};
+
+	auto single = Walker(1).walk(walkerDirectory, descend);
+	auto multiple = Walker(4).walk(walkerDirectory, descend);
+
+	EXPECT_EQ(single.size(), 200);
+	EXPECT_EQ(multiple.size(), single.size(), return);
+	EXPECT(std::is_sorted(multiple.begin(), multiple.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.path() < rhs.path();
+	}));
+	for (size_t i = 0; i < single.size(); ++i) {
+		EXPECT_EQ(single.at(i).path().string(), multiple.at(i).path().string());
+	}
+
+	std::filesystem::remove_all(walkerDirectory);
+}
+
+TEST_CASE(WalkerSkipsDirectorySymlinks)
+{
+	createWalkerTree(1, 1);
+	std::filesystem::create_directory_symlink(walkerDirectory / "__dir-0", walkerDirectory / "__symlink");
+
+	auto entries = Walker(2).walk(walkerDirectory);
+
+	EXPECT_EQ(entries.size(), 2);
+	for (const auto& entry : entries) {
+		EXPECT(entry.path().string().find("__symlink") == std::string::npos);
+	}
+
+	std::filesystem::remove_all(walkerDirectory);
+}
+
+TEST_CASE(WalkerContinuesFromDirectories)
+{
+	createWalkerTree(20, 10);
+
+	// Continuing below part of the directories finds the same entries as a full walk below them
+	std::vector<std::filesystem::path> directories;
+	for (size_t i = 0; i < 20; i += 2) {
+		directories.push_back(walkerDirectory / ("__dir-" + std::to_string(i)));
+	}
+
+	auto entries = Walker(4).walk(directories);
+	EXPECT_EQ(entries.size(), 100);
+	EXPECT(std::is_sorted(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.path() < rhs.path();
+	}));
+	EXPECT_EQ(entries.front().path().string(), (walkerDirectory / "__dir-0" / "__subdir" / "__file-0").string());
+	EXPECT(Walker(2).walk(std::vector<std::filesystem::path> {}).empty());
+
+	std::filesystem::remove_all(walkerDirectory);
+}
+
+TEST_CASE(WalkerIdleThreadsSleep)
+{
+	createWalkerTree(4, 1);
+
+	// One slow directory listing, like on a network filesystem, while the other threads have nothing to do
+	auto descend = [](const std::filesystem::directory_entry& directory) -> bool {
+		if (directory.path().filename() == "__pruned") {
+			std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		}
+		return true;
+	};
+
+	struct rusage before;
+	struct rusage after;
+	getrusage(RUSAGE_SELF, &before);
+	auto entries = Walker(4).walk(walkerDirectory, descend);
+	getrusage(RUSAGE_SELF, &after);
+
+	auto cpu = [](const struct rusage& usage) -> double {
+		return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+		       + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+	};
+	double used = cpu(after) - cpu(before);
+	printf("        300ms listing with 4 threads: %fms cpu time\n", used);
+
+	EXPECT_EQ(entries.size(), 5);
+	// Threads that spin while waiting would burn the whole 300ms, at least on one core
+	EXPECT(used < 150.0);
+
+	std::filesystem::remove_all(walkerDirectory);
+}